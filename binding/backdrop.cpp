@@ -128,10 +128,13 @@ static VALUE backdrop_vignette_bitmap(VALUE self, VALUE color_kind)
   return self == graphics ? bitmap : rb_iv_set(self, "@bitmap", bitmap);
 }
 
-static VALUE backdrop_blur_bitmap(VALUE self)
+static VALUE backdrop_blur_bitmap(int argc, VALUE* argv, VALUE self)
 {
   Bitmap *b = shState->graphics().snapToBitmap();
-  b->blur();
+  if (argc > 0)
+    b->blur(NUM2INT(argv[0]));
+  else
+    b->blur();
   VALUE bitmap = wrapObject(b, BitmapType);
   return rb_iv_set(self, "@bitmap", bitmap);
 }
@@ -185,7 +188,7 @@ void init_backdrop()
   rb_define_module_function(backdrop, "vignette_bitmap",
                             RMF(backdrop_vignette_bitmap), 1);
   rb_define_module_function(backdrop, "blur_bitmap",
-                            RMF(backdrop_blur_bitmap), 0);
+                            RMF(backdrop_blur_bitmap), -1);
   rb_define_module_function(backdrop, "bitmap",
                             RMF(backdrop_bitmap), 0);
   rb_define_module_function(backdrop, "bitmap_dup",
@@ -25,6 +25,7 @@
 #include "font.h"
 #include "exception.h"
 #include "sharedstate.h"
+#include "imagecache.h"
 #include "disposable-binding.h"
 #include "binding-util.h"
 #include "binding-types.h"
@@ -350,6 +351,55 @@ static VALUE bitmap_fill_polygon(int argc, VALUE* argv, VALUE self)
   return self;
 }
 
+/* Fields of each draw_shapes record: type, x, y, width, height,
+ * red, green, blue, alpha, radius, angle, sides */
+#define SHAPE_FIELDS 12
+
+static Bitmap::Shape bitmap_shape_from(const float *f)
+{
+  Bitmap::Shape s;
+  int type = (int) f[0];
+  if (type < Bitmap::Shape::RoundedRect || type > Bitmap::Shape::Polygon)
+    rb_raise(rb_eArgError, "draw_shapes: invalid shape type %d", type);
+  s.type = (Bitmap::Shape::Type) type;
+  s.rect = IntRect(f[1], f[2], f[3], f[4]);
+  s.color = Vec4(f[5] / 255.0f, f[6] / 255.0f, f[7] / 255.0f, f[8] / 255.0f);
+  s.radius = f[9];
+  s.angle = f[10];
+  s.sides = f[11];
+  return s;
+}
+
+/* Takes a flat Array of numbers or a String packed with 'f*',
+ * SHAPE_FIELDS values per shape */
+static VALUE bitmap_draw_shapes(VALUE self, VALUE data)
+{
+  Bitmap *b = getPrivateData<Bitmap>(self);
+  std::vector<Bitmap::Shape> shapes;
+  if (RB_TYPE_P(data, RUBY_T_STRING)) {
+    long count = RSTRING_LEN(data) / (SHAPE_FIELDS * sizeof(float));
+    const char *ptr = RSTRING_PTR(data);
+    float fields[SHAPE_FIELDS];
+    shapes.reserve(count);
+    for (long i = 0; i < count; i++) {
+      memcpy(fields, ptr + i * sizeof(fields), sizeof(fields));
+      shapes.push_back(bitmap_shape_from(fields));
+    }
+  } else {
+    Check_Type(data, RUBY_T_ARRAY);
+    long count = RARRAY_LEN(data) / SHAPE_FIELDS;
+    float fields[SHAPE_FIELDS];
+    shapes.reserve(count);
+    for (long i = 0; i < count; i++) {
+      for (int j = 0; j < SHAPE_FIELDS; j++)
+        fields[j] = NUM2DBL(rb_ary_entry(data, i * SHAPE_FIELDS + j));
+      shapes.push_back(bitmap_shape_from(fields));
+    }
+  }
+  GUARD_EXC( b->drawShapes(shapes); );
+  return self;
+}
+
 static VALUE bitmapClear(VALUE self)
 {
   Bitmap *b = getPrivateData<Bitmap>(self);
@@ -464,6 +514,65 @@ static VALUE bitmap_turn_sepia(VALUE self)
   return self;
 }
 
+/* Each entry is a Symbol or an Array of a Symbol and its arguments,
+ * i.e. [[:hue, 90], :gray, :sepia] or [:color_mask, 10, color] */
+static Bitmap::Filter bitmap_filter_from(VALUE entry)
+{
+  VALUE args[5] = { Qnil, Qnil, Qnil, Qnil, Qnil };
+  long argc = 1;
+  if (RB_TYPE_P(entry, RUBY_T_ARRAY)) {
+    argc = RARRAY_LEN(entry);
+    if (argc < 1 || argc > 5)
+      rb_raise(rb_eArgError, "apply_filters: expected [filter, args...]");
+    for (long i = 0; i < argc; i++)
+      args[i] = rb_ary_entry(entry, i);
+  } else {
+    args[0] = entry;
+  }
+  VALUE name = args[0];
+  if (name == hc_sym("gray"))
+    return Bitmap::Filter(Bitmap::Filter::Gray,
+      Vec4(argc > 1 ? NUM2DBL(args[1]) : 1.0, 0, 0, 0));
+  if (name == hc_sym("sepia"))
+    return Bitmap::Filter(Bitmap::Filter::Sepia);
+  if (name == hc_sym("hue") && argc > 1)
+    return Bitmap::Filter(Bitmap::Filter::Hue, Vec4(NUM2INT(args[1]), 0, 0, 0));
+  if (name == hc_sym("thermal"))
+    return Bitmap::Filter(Bitmap::Filter::Thermal);
+  if (name == hc_sym("invert"))
+    return Bitmap::Filter(Bitmap::Filter::Invert);
+  if (name == hc_sym("grayscale"))
+    return Bitmap::Filter(Bitmap::Filter::GrayScale);
+  if (name == hc_sym("invert_grayscale"))
+    return Bitmap::Filter(Bitmap::Filter::GrayScale, Vec4(1, 0, 0, 0));
+  if (name == hc_sym("color_mask") && (argc == 3 || argc == 5)) {
+    float range = clamp<float>(NUM2INT(args[1]), 0.0f, 100.0f) / 100.0f;
+    Vec4 color;
+    if (argc == 3) {
+      Color *c = getPrivateDataCheck<Color>(args[2], ColorType);
+      color = c->norm;
+    } else {
+      color = Vec4(NUM2INT(args[2]) / 255.0f, NUM2INT(args[3]) / 255.0f,
+                   NUM2INT(args[4]) / 255.0f, 0);
+    }
+    color.w = range;
+    return Bitmap::Filter(Bitmap::Filter::ColorMask, color);
+  }
+  VALUE str = rb_funcall(entry, rb_intern("inspect"), 0);
+  rb_raise(rb_eArgError, "apply_filters: invalid filter %s", RSTRING_PTR(str));
+}
+
+static VALUE bitmap_apply_filters(VALUE self, VALUE list)
+{
+  Bitmap *b = getPrivateData<Bitmap>(self);
+  Check_Type(list, RUBY_T_ARRAY);
+  std::vector<Bitmap::Filter> filters;
+  for (long i = 0; i < RARRAY_LEN(list); i++)
+    filters.push_back(bitmap_filter_from(rb_ary_entry(list, i)));
+  GUARD_EXC( b->applyFilters(filters); );
+  return self;
+}
+
 static VALUE bitmap_invert(VALUE self)
 {
   Bitmap *b = getPrivateData<Bitmap>(self);
@@ -537,6 +646,105 @@ static VALUE bitmapGetMaxSize(VALUE self)
   return RB_INT2FIX(Bitmap::maxSize());
 }
 
+static VALUE bitmap_s_cached(int argc, VALUE* argv, VALUE self)
+{
+  VALUE filename;
+  int hue = 0;
+  rb_get_args(argc, argv, "S|i", &filename, &hue RB_ARG_END);
+  Bitmap *b = 0;
+  GUARD_EXC( b = Bitmap::cached(RSTRING_PTR(filename), hue); );
+  VALUE obj = rb_obj_alloc(self);
+  rb_iv_set(obj, "stub", Qfalse);
+  setPrivateData(obj, b);
+  bitmapInitProps(b, obj);
+  rb_iv_set(obj, "disposed", Qfalse);
+  return obj;
+}
+
+static VALUE bitmapWrapAsync(VALUE klass, VALUE filename)
+{
+  SafeStringValue(filename);
+  Bitmap *b = 0;
+  GUARD_EXC( b = Bitmap::loadAsync(RSTRING_PTR(filename)); );
+  VALUE obj = rb_obj_alloc(klass);
+  rb_iv_set(obj, "stub", Qfalse);
+  setPrivateData(obj, b);
+  bitmapInitProps(b, obj);
+  rb_iv_set(obj, "disposed", Qfalse);
+  return obj;
+}
+
+static VALUE bitmap_s_load_async(VALUE self, VALUE filename)
+{
+  return bitmapWrapAsync(self, filename);
+}
+
+static VALUE bitmap_s_load_async_all(VALUE self, VALUE list)
+{ // Every file is queued before the first one could block anything
+  list = rb_Array(list);
+  long n = RARRAY_LEN(list);
+  VALUE result = rb_ary_new_capa(n);
+  for (long i = 0; i < n; i++)
+    rb_ary_push(result, bitmapWrapAsync(self, rb_ary_entry(list, i)));
+  return result;
+}
+
+static VALUE bitmap_is_loaded(VALUE self)
+{
+  Bitmap *b = getPrivateData<Bitmap>(self);
+  bool loaded;
+  GUARD_EXC( loaded = b->isLoaded(); );
+  return loaded ? Qtrue : Qfalse;
+}
+
+static VALUE bitmap_move_to_atlas(VALUE self)
+{
+  Bitmap *b = getPrivateData<Bitmap>(self);
+  bool moved;
+  GUARD_EXC( moved = b->moveToAtlas(); );
+  return moved ? Qtrue : Qfalse;
+}
+
+static VALUE bitmap_is_in_atlas(VALUE self)
+{
+  Bitmap *b = getPrivateData<Bitmap>(self);
+  bool inAtlas;
+  GUARD_EXC( inAtlas = b->isInAtlas(); );
+  return inAtlas ? Qtrue : Qfalse;
+}
+
+static VALUE bitmap_s_cache_stats(VALUE self)
+{
+  ImageCache::Stats st = shState->imageCache().getStats();
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, hc_sym("hits"), ULL2NUM(st.hits));
+  rb_hash_aset(hash, hc_sym("misses"), ULL2NUM(st.misses));
+  rb_hash_aset(hash, hc_sym("evictions"), ULL2NUM(st.evictions));
+  rb_hash_aset(hash, hc_sym("bytes"), ULL2NUM(st.bytes));
+  rb_hash_aset(hash, hc_sym("budget"), ULL2NUM(st.budget));
+  rb_hash_aset(hash, hc_sym("entries"), RB_INT2FIX(st.entries));
+  rb_hash_aset(hash, hc_sym("idle"), RB_INT2FIX(st.idleEntries));
+  return hash;
+}
+
+static VALUE bitmap_s_cache_budget(VALUE self)
+{
+  return ULL2NUM(shState->imageCache().getBudget());
+}
+
+static VALUE bitmap_s_cache_budget_set(VALUE self, VALUE bytes)
+{
+  long long value = NUM2LL(bytes);
+  shState->imageCache().setBudget(value < 0 ? 0 : value);
+  return bytes;
+}
+
+static VALUE bitmap_s_clear_cache(VALUE self)
+{
+  shState->imageCache().clear();
+  return Qnil;
+}
+
 static VALUE bitmapGetFont(VALUE self)
 {
   checkDisposed<Bitmap>(self);
@@ -595,10 +803,15 @@ static VALUE bitmapClearRect(int argc, VALUE* argv, VALUE self)
   return self;
 }
 
-static VALUE bitmapBlur(VALUE self)
+static VALUE bitmapBlur(int argc, VALUE* argv, VALUE self)
 {
   Bitmap *b = getPrivateData<Bitmap>(self);
-  b->blur();
+  GUARD_EXC(
+    if (argc > 0)
+      b->blur(NUM2INT(argv[0]));
+    else
+      b->blur();
+  )
   return self;
 }
 
@@ -694,6 +907,9 @@ void bitmapBindingInit()
   rb_define_method(klass, "initialize", RMF(bitmapInitialize), -1);
   rb_define_method(klass, "initialize_copy", RMF(bitmapInitializeCopy), -1);
   rb_define_method(klass, "stub?", RMF(bitmap_is_stub), 0);
+  rb_define_method(klass, "loaded?", RMF(bitmap_is_loaded), 0);
+  rb_define_method(klass, "move_to_atlas", RMF(bitmap_move_to_atlas), 0);
+  rb_define_method(klass, "in_atlas?", RMF(bitmap_is_in_atlas), 0);
   rb_define_method(klass, "width", RMF(bitmapWidth), 0);
   rb_define_method(klass, "height", RMF(bitmapHeight), 0);
   rb_define_method(klass, "set_wh", RMF(bitmap_set_wh), 2);
@@ -713,12 +929,18 @@ void bitmapBindingInit()
   rb_define_method(klass, "color_mask", RMF(bitmap_color_mask), -1);
   rb_define_method(klass, "thermal", RMF(bitmap_thermal), 0);
   rb_define_method(klass, "turn_sepia", RMF(bitmap_turn_sepia), 0);
+  rb_define_method(klass, "apply_filters", RMF(bitmap_apply_filters), 1);
   rb_define_method(klass, "invert!", RMF(bitmap_invert), 0);
   rb_define_method(klass, "draw_text", RMF(bitmap_draw_text), -1);
   rb_define_method(klass, "text_size", RMF(bitmap_text_size), 1);
   rb_define_method(klass, "text_width", RMF(bitmap_text_width), 1);
   rb_define_method(klass, "text_height", RMF(bitmap_text_height), 1);
   rb_define_method(klass, "fill_polygon", RMF(bitmap_fill_polygon), -1);
+  rb_define_method(klass, "draw_shapes", RMF(bitmap_draw_shapes), 1);
+  rb_define_const(klass, "SHAPE_ROUNDED_RECT", INT2FIX(Bitmap::Shape::RoundedRect));
+  rb_define_const(klass, "SHAPE_CIRCLE", INT2FIX(Bitmap::Shape::Circle));
+  rb_define_const(klass, "SHAPE_TRIANGLE", INT2FIX(Bitmap::Shape::Triangle));
+  rb_define_const(klass, "SHAPE_POLYGON", INT2FIX(Bitmap::Shape::Polygon));
   rb_define_method(klass, "fill_triangle", RMF(bitmap_fill_triangle), -1);
   rb_define_method(klass, "fill_circle", RMF(bitmap_fill_circle), -1);
   rb_define_method(klass, "fill_rounded_rect", RMF(bitmap_fill_rounded_rect), -1);
@@ -726,11 +948,18 @@ void bitmapBindingInit()
   rb_define_method(klass, "storm_fill_rect", RMF(bitmapStormFillRect), 1);
   rb_define_method(klass, "snow_fill_rect", RMF(bitmapSnowFillRect), 0);
   rb_define_method(klass, "clear_rect", RMF(bitmapClearRect), -1);
-  rb_define_method(klass, "blur", RMF(bitmapBlur), 0);
+  rb_define_method(klass, "blur", RMF(bitmapBlur), -1);
   rb_define_method(klass, "radial_blur", RMF(bitmapRadialBlur), 2);
   rb_define_method(klass, "font", RMF(bitmapGetFont), 0);
   rb_define_method(klass, "font=", RMF(bitmapSetFont), 1);
   rb_define_method(klass, "write", RMF(bitmap_write), -1);
   rb_define_method(klass, "to_file", RMF(bitmap_write), -1);
   rb_define_singleton_method(klass, "max_size", RMF(bitmapGetMaxSize), 0);
+  rb_define_singleton_method(klass, "cached", RMF(bitmap_s_cached), -1);
+  rb_define_singleton_method(klass, "cache_stats", RMF(bitmap_s_cache_stats), 0);
+  rb_define_singleton_method(klass, "cache_budget", RMF(bitmap_s_cache_budget), 0);
+  rb_define_singleton_method(klass, "cache_budget=", RMF(bitmap_s_cache_budget_set), 1);
+  rb_define_singleton_method(klass, "clear_cache", RMF(bitmap_s_clear_cache), 0);
+  rb_define_singleton_method(klass, "load_async", RMF(bitmap_s_load_async), 1);
+  rb_define_singleton_method(klass, "load_async_all", RMF(bitmap_s_load_async_all), 1);
 }
@@ -24,6 +24,11 @@
 #include "graphics.h"
 #include <SDL_image.h>
 #include "sharedstate.h"
+#include "texpool.h"
+#include "glstate.h"
+#include "frameprofiler.h"
+#include "gputimer.h"
+#include "benchmark.h"
 #include "binding-util.h"
 #include "binding-types.h"
 #include "exception.h"
@@ -32,9 +37,30 @@
 
 extern VALUE rect_from_ary(VALUE ary);
 
+static void run_screenshot_callbacks(VALUE self)
+{
+  std::vector<int> done;
+  shState->graphics().finished_screenshots(done);
+  if (done.empty())
+    return;
+  VALUE callbacks = rb_iv_get(self, "screenshot_callbacks");
+  for (size_t i = 0; i < done.size(); i++) {
+    VALUE block = RB_NIL_P(callbacks) ? Qnil :
+                  rb_hash_delete(callbacks, RB_INT2FIX(done[i]));
+    if (RB_NIL_P(block))
+      continue;
+    bool saved = shState->graphics().screenshot_status(done[i]) > 0;
+    std::string path = shState->graphics().screenshot_path(done[i]);
+    shState->graphics().forget_screenshot(done[i]);
+    rb_funcall(block, rb_intern("call"), 2, saved ? Qtrue : Qfalse,
+               rb_str_new_cstr(path.c_str()));
+  }
+}
+
 static VALUE graphicsUpdate(VALUE self)
 {
   shState->graphics().update();
+  run_screenshot_callbacks(self);
   return Qnil;
 }
 
@@ -179,6 +205,173 @@ static VALUE graphics_save_screenshot(VALUE self)
   return result ? Qtrue : Qfalse;
 }
 
+static VALUE graphics_save_screenshot_async(VALUE self)
+{
+  int ticket;
+  GUARD_EXC( ticket = shState->graphics().save_screenshot_async(); )
+  if (rb_block_given_p()) {
+    VALUE callbacks = rb_iv_get(self, "screenshot_callbacks");
+    if (RB_NIL_P(callbacks)) {
+      callbacks = rb_hash_new();
+      rb_iv_set(self, "screenshot_callbacks", callbacks);
+    }
+    rb_hash_aset(callbacks, RB_INT2FIX(ticket), rb_block_proc());
+  }
+  return RB_INT2FIX(ticket);
+}
+
+static VALUE graphics_screenshot_status(VALUE self, VALUE ticket)
+{
+  int status = shState->graphics().screenshot_status(NUM2INT(ticket));
+  switch (status) {
+  case 0:
+    return hc_sym("pending");
+  case 1:
+    return hc_sym("saved");
+  case -1:
+    return hc_sym("failed");
+  }
+  return hc_sym("unknown");
+}
+
+static VALUE graphics_pick(VALUE self, VALUE x, VALUE y)
+{ // Only sprites and windows set as pickable take part
+  // Their mark functions pin pickable objects, the VALUE stays valid
+  void *data = shState->graphics().pick(NUM2INT(x), NUM2INT(y));
+  return data ? (VALUE) data : Qnil;
+}
+
+static VALUE graphics_texture_pool_budget(VALUE self)
+{
+  return ULL2NUM(shState->texPool().getBudget());
+}
+
+static VALUE graphics_texture_pool_budget_set(VALUE self, VALUE bytes)
+{
+  long long value = NUM2LL(bytes);
+  if (value < 0)
+    rb_raise(rb_eArgError, "texture pool budget can't be negative");
+  shState->texPool().setBudget(value);
+  return bytes;
+}
+
+static VALUE graphics_texture_pool_stats(VALUE self)
+{
+  TexPool::Stats stats = shState->texPool().getStats();
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, hc_sym("hits"), ULL2NUM(stats.hits));
+  rb_hash_aset(hash, hc_sym("near_hits"), ULL2NUM(stats.nearHits));
+  rb_hash_aset(hash, hc_sym("misses"), ULL2NUM(stats.misses));
+  rb_hash_aset(hash, hc_sym("evictions"), ULL2NUM(stats.evictions));
+  rb_hash_aset(hash, hc_sym("bytes"), ULL2NUM(stats.bytes));
+  rb_hash_aset(hash, hc_sym("cached"), ULL2NUM(stats.cached));
+  return hash;
+}
+
+static VALUE graphics_gl_state_stats(VALUE self)
+{
+  const GLStateCounters &frame = glState.lastFrame;
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, hc_sym("issued"), UINT2NUM(frame.issued));
+  rb_hash_aset(hash, hc_sym("elided"), UINT2NUM(frame.elided));
+  rb_hash_aset(hash, hc_sym("draws"), UINT2NUM(frame.draws));
+  rb_hash_aset(hash, hc_sym("uploads"), UINT2NUM(frame.uploads));
+  return hash;
+}
+
+static VALUE graphics_calibrate_frame_pacer(VALUE self)
+{
+  return RB_INT2FIX(shState->graphics().calibrateFramePacer());
+}
+
+static VALUE graphics_frame_time_histogram(VALUE self)
+{
+  std::vector<uint32_t> counts;
+  shState->graphics().getFrameHistogram(counts);
+  VALUE ary = rb_ary_new2(counts.size());
+  for (size_t i = 0; i < counts.size(); i++)
+    rb_ary_push(ary, UINT2NUM(counts[i]));
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, hc_sym("bucket_us"), RB_INT2FIX(FRAME_HIST_BIN_US));
+  rb_hash_aset(hash, hc_sym("counts"), ary);
+  return hash;
+}
+
+static VALUE graphics_reset_frame_time_histogram(VALUE self)
+{
+  shState->graphics().resetFrameHistogram();
+  return Qnil;
+}
+
+static VALUE graphics_profiling(VALUE self)
+{
+  return FrameProfiler::enabled() ? Qtrue : Qfalse;
+}
+
+static VALUE graphics_profiling_set(VALUE self, VALUE value)
+{
+  FrameProfiler::setEnabled(RTEST(value));
+  return value;
+}
+
+static VALUE frame_stats_hash(const FrameProfiler::Frame &frame)
+{
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, hc_sym("frame"), UINT2NUM(frame.index));
+  rb_hash_aset(hash, hc_sym("total"), DBL2NUM(frame.total / 1000.0));
+  for (int i = 0; i < FrameProfiler::PhaseCount; i++) {
+    VALUE ms = DBL2NUM(frame.phases[i] / 1000.0);
+    rb_hash_aset(hash, hc_sym(FrameProfiler::phaseName(i)), ms);
+  }
+  return hash;
+}
+// Times in ms of the last frame, or an Array of the last 'count' ones
+static VALUE graphics_frame_stats(int argc, VALUE *argv, VALUE self)
+{
+  static FrameProfiler::Frame frames[PROFILER_FRAMES];
+  int max = argc > 0 ? RB_NUM2INT(argv[0]) : 1;
+  max = max < 1 ? 1 : (max > PROFILER_FRAMES ? PROFILER_FRAMES : max);
+  int count = FrameProfiler::lastFrames(frames, max);
+  if (argc == 0)
+    return count ? frame_stats_hash(frames[0]) : Qnil;
+  VALUE ary = rb_ary_new2(count);
+  for (int i = 0; i < count; i++)
+    rb_ary_push(ary, frame_stats_hash(frames[i]));
+  return ary;
+}
+
+static VALUE graphics_write_frame_trace(VALUE self, VALUE path)
+{
+  return FrameProfiler::writeTrace(StringValueCStr(path)) ? Qtrue : Qfalse;
+}
+
+/* GPU time in ms per pass of a frame a few frames back,
+ * nil without timer query support or before any came back */
+static VALUE graphics_gpu_timings(VALUE self)
+{
+  GPUTimer::Timings timings;
+  if (!GPUTimer::lastTimings(timings))
+    return Qnil;
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, hc_sym("frame"), UINT2NUM(timings.frame));
+  for (int i = 0; i < GPUTimer::PassCount; i++) {
+    VALUE ms = DBL2NUM(timings.passes[i] / 1000000.0);
+    rb_hash_aset(hash, hc_sym(GPUTimer::passName(i)), ms);
+  }
+  return hash;
+}
+
+static VALUE graphics_is_benchmark(VALUE self)
+{
+  return Benchmark::active() ? Qtrue : Qfalse;
+}
+
+// Lets a benchmark scene end the run once it's done
+static VALUE graphics_finish_benchmark(VALUE self)
+{
+  return shState->graphics().finishBenchmark() ? Qtrue : Qfalse;
+}
+
 static VALUE graphics_resize_screen(int n, VALUE *args, VALUE self)
 {
   if (!n || n > 3)
@@ -425,6 +618,23 @@ void graphicsBindingInit()
   module_func(graph, "save_screenshot", graphics_save_screenshot, 0);
   module_func(graph, "screenshot", graphics_save_screenshot, 0);
   module_func(graph, "snapshot", graphics_save_screenshot, 0);
+  module_func(graph, "save_screenshot_async", graphics_save_screenshot_async, 0);
+  module_func(graph, "screenshot_status", graphics_screenshot_status, 1);
+  module_func(graph, "pick", graphics_pick, 2);
+  module_func(graph, "texture_pool_budget", graphics_texture_pool_budget, 0);
+  module_func(graph, "texture_pool_budget=", graphics_texture_pool_budget_set, 1);
+  module_func(graph, "texture_pool_stats", graphics_texture_pool_stats, 0);
+  module_func(graph, "gl_state_stats", graphics_gl_state_stats, 0);
+  module_func(graph, "calibrate_frame_pacer", graphics_calibrate_frame_pacer, 0);
+  module_func(graph, "frame_time_histogram", graphics_frame_time_histogram, 0);
+  module_func(graph, "reset_frame_time_histogram", graphics_reset_frame_time_histogram, 0);
+  module_func(graph, "profiling", graphics_profiling, 0);
+  module_func(graph, "profiling=", graphics_profiling_set, 1);
+  module_func(graph, "frame_stats", graphics_frame_stats, -1);
+  module_func(graph, "write_frame_trace", graphics_write_frame_trace, 1);
+  module_func(graph, "gpu_timings", graphics_gpu_timings, 0);
+  module_func(graph, "benchmark?", graphics_is_benchmark, 0);
+  module_func(graph, "finish_benchmark", graphics_finish_benchmark, 0);
   module_func(graph, "resize", graphics_resize_screen, -1);
   module_func(graph, "resize_screen", graphics_resize_screen, -1);
   module_func(graph, "resize_window", graphics_window_size_factor, 2);
@@ -36,8 +36,17 @@
 
 extern VALUE rect_from_ary(VALUE ary);
 
+/* Graphics.pick hands the pick data back as a raw VALUE, so a
+ * pickable sprite pins itself instead of letting GC.compact move it */
+static void spriteMark(void *data)
+{
+  Sprite *s = static_cast<Sprite*>(data);
+  if (s && !s->isDisposed() && s->getPickData())
+    rb_gc_mark((VALUE) s->getPickData());
+}
+
 rb_data_type_t SpriteType = { "Sprite",
-  { 0, freeInstance<Sprite>, type_slots }, 0, 0, 0 };
+  { spriteMark, freeInstance<Sprite>, type_slots }, 0, 0, 0 };
 
 static VALUE spriteInitialize(int argc, VALUE* argv, VALUE self)
 {
@@ -589,6 +598,24 @@ static VALUE sprite_is_mouse_above_color(VALUE self)
   return s->mouse_is_above_color_found() ? Qtrue : Qfalse;
 }
 
+static VALUE sprite_is_pickable(VALUE self)
+{
+  Sprite *s = getPrivateData<Sprite>(self);
+  if (!s)
+    return Qnil;
+  return s->getPickData() ? Qtrue : Qfalse;
+}
+
+static VALUE sprite_pickable_set(VALUE self, VALUE state)
+{
+  Sprite *s = getPrivateData<Sprite>(self);
+  if (!s)
+    return Qnil;
+  // Pinned by spriteMark, so self never moves or dangles
+  s->setPickData(RTEST(state) ? (void*) self : 0);
+  return state;
+}
+
 static VALUE sprite_mouse_target(VALUE self)
 {
   VALUE mouse = rb_define_module("Mouse");
@@ -749,6 +776,8 @@ void SpriteBindingInit()
   rb_define_method(sprite, "mouse_inside_color?", RMF(sprite_is_mouse_above_color), 0);
   rb_define_method(sprite, "mouse_above_color?", RMF(sprite_is_mouse_above_color), 0);
   rb_define_method(sprite, "mouse_target?", RMF(sprite_mouse_target), 0);
+  rb_define_method(sprite, "pickable?", RMF(sprite_is_pickable), 0);
+  rb_define_method(sprite, "pickable=", RMF(sprite_pickable_set), 1);
   rb_define_method(sprite, "drag_always?", RMF(sprite_drag_always), 0);
   rb_define_method(sprite, "drag_color?", RMF(sprite_drag_color), 0);
   rb_define_method(sprite, "draggable?", RMF(sprite_draggable), 0);
@@ -21,7 +21,9 @@
 
 #include "type_slots.h"
 #include <algorithm>
+#include <string.h>
 #include "table.h"
+#include "util.h"
 #include "binding-util.h"
 #include "serializable-binding.h"
 
@@ -135,6 +137,77 @@ RB_METHOD(tableSetAt)
   return argv[argc - 1];
 }
 
+static TableRegion regionFromArgs(VALUE *argv)
+{
+  return TableRegion(NUM2INT(argv[0]), NUM2INT(argv[1]), NUM2INT(argv[2]),
+    NUM2INT(argv[3]), NUM2INT(argv[4]), NUM2INT(argv[5]));
+}
+
+// fill_region(x, y, z, w, h, d, value)
+RB_METHOD(tableFillRegion)
+{
+  rb_check_argc(argc, 7);
+  Table *t = getPrivateData<Table>(self);
+  TableRegion r = regionFromArgs(argv);
+  t->fill(r, NUM2INT(argv[6]));
+  return self;
+}
+// copy_region(dx, dy, dz, src_table, sx, sy, sz, w, h, d)
+RB_METHOD(tableCopyRegion)
+{
+  rb_check_argc(argc, 10);
+  Table *t = getPrivateData<Table>(self);
+  Table *src = getPrivateDataCheck<Table>(argv[3], TableType);
+  if (!src)
+    raiseDisposedAccess(argv[3]);
+  TableRegion r = regionFromArgs(argv + 4);
+  t->copyRegion(NUM2INT(argv[0]), NUM2INT(argv[1]), NUM2INT(argv[2]), *src, r);
+  return self;
+}
+// read_region(x, y, z, w, h, d) => String of packed 16 bit cells
+RB_METHOD(tableReadRegion)
+{
+  rb_check_argc(argc, 6);
+  Table *t = getPrivateData<Table>(self);
+  TableRegion r = regionFromArgs(argv);
+  if (!t->containsRegion(r))
+    rb_raise(rb_eArgError, "Table: region out of bounds");
+  VALUE str = rb_str_new(0, r.cellCount() * sizeof(int16_t));
+  GUARD_EXC( t->readRegion(r, (int16_t*) RSTRING_PTR(str)); )
+  return str;
+}
+// write_region(x, y, z, w, h, d, string)
+RB_METHOD(tableWriteRegion)
+{
+  rb_check_argc(argc, 7);
+  Table *t = getPrivateData<Table>(self);
+  TableRegion r = regionFromArgs(argv);
+  VALUE str = argv[6];
+  StringValue(str);
+  long len = RSTRING_LEN(str);
+  if (len != (long) (r.cellCount() * sizeof(int16_t)))
+    rb_raise(rb_eArgError, "Table: expected %d bytes of cell data, got %ld",
+      (int) (r.cellCount() * sizeof(int16_t)), len);
+  // The string buffer might not be aligned for int16_t access
+  std::vector<int16_t> cells(r.cellCount());
+  if (!cells.empty())
+    memcpy(&cells[0], RSTRING_PTR(str), len);
+  GUARD_EXC( t->writeRegion(r, dataPtr(cells)); )
+  return self;
+}
+// add_region(x, y, z, w, h, d, delta, min = -32768, max = 32767)
+RB_METHOD(tableAddRegion)
+{
+  if (argc < 7 || argc > 9)
+    rb_error_arity(argc, 7, 9);
+  Table *t = getPrivateData<Table>(self);
+  TableRegion r = regionFromArgs(argv);
+  int min = argc > 7 ? NUM2INT(argv[7]) : -32768;
+  int max = argc > 8 ? NUM2INT(argv[8]) : 32767;
+  t->addRegion(r, NUM2INT(argv[6]), min, max);
+  return self;
+}
+
 MARSH_LOAD_FUN(Table)
 INITCOPY_FUN(Table)
 
@@ -152,4 +225,9 @@ void tableBindingInit()
   rb_define_method(klass, "zsize", RUBY_METHOD_FUNC(tableZSize), 0);
   rb_define_method(klass, "[]", RUBY_METHOD_FUNC(tableGetAt), -1);
   rb_define_method(klass, "[]=", RUBY_METHOD_FUNC(tableSetAt), -1);
+  rb_define_method(klass, "fill_region", RUBY_METHOD_FUNC(tableFillRegion), -1);
+  rb_define_method(klass, "copy_region", RUBY_METHOD_FUNC(tableCopyRegion), -1);
+  rb_define_method(klass, "read_region", RUBY_METHOD_FUNC(tableReadRegion), -1);
+  rb_define_method(klass, "write_region", RUBY_METHOD_FUNC(tableWriteRegion), -1);
+  rb_define_method(klass, "add_region", RUBY_METHOD_FUNC(tableAddRegion), -1);
 }
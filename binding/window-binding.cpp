@@ -34,8 +34,17 @@
 
 DECL_TYPE(Rect);
 
+/* Graphics.pick hands the pick data back as a raw VALUE,
+ * so a pickable window must never be moved by GC.compact */
+static void windowMark(void *data)
+{
+  Window *w = static_cast<Window*>(data);
+  if (w && !w->isDisposed() && w->getPickData())
+    rb_gc_mark((VALUE) w->getPickData());
+}
+
 rb_data_type_t WindowType = { "Window",
-  { 0, freeInstance<Window>, type_slots }, 0, 0, 0 };
+  { windowMark, freeInstance<Window>, type_slots }, 0, 0, 0 };
 
 extern VALUE zero;
 
@@ -321,6 +330,23 @@ static VALUE window_is_mouse_inside(int argc, VALUE *v, VALUE self)
   return w->is_mouse_inside(r->x, r->y, r->width, r->height) ? Qtrue : Qfalse;
 }
 
+static VALUE window_is_pickable(VALUE self)
+{
+  Window *w = getPrivateData<Window>(self);
+  if (!w)
+    return Qnil;
+  return w->getPickData() ? Qtrue : Qfalse;
+}
+
+static VALUE window_pickable_set(VALUE self, VALUE state)
+{
+  Window *w = getPrivateData<Window>(self);
+  if (!w)
+    return Qnil;
+  w->setPickData(RTEST(state) ? (void*) self : 0);
+  return state;
+}
+
 static VALUE window_mouse_target(VALUE self)
 {
   VALUE mouse = rb_define_module("Mouse");
@@ -384,6 +410,8 @@ void windowBindingInit()
   rb_define_method(klass, "mouse_inside?", RMF(window_is_mouse_inside), -1);
   rb_define_method(klass, "mouse_above?", RMF(window_is_mouse_inside), -1);
   rb_define_method(klass, "mouse_target?", RMF(window_mouse_target), 0);
+  rb_define_method(klass, "pickable?", RMF(window_is_pickable), 0);
+  rb_define_method(klass, "pickable=", RMF(window_pickable_set), 1);
   rb_define_method(klass, "draggable?", RMF(window_mouse_draggable), 0);
   rb_define_method(klass, "draggable=", RMF(window_mouse_draggable_set), 1);
   rb_define_attr(klass, "area", 1, 0);
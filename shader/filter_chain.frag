@@ -0,0 +1,83 @@
+
+uniform sampler2D texture;
+varying vec2 v_texCoord;
+
+/* Keep in sync with FILTER_CHAIN_MAX in shader.h */
+#define MAX_OPS 8
+
+/* One entry per operation, see FilterChainShader::Op */
+uniform float ops[MAX_OPS];
+uniform vec4 params[MAX_OPS];
+uniform int opCount;
+
+const vec3 lumaF = vec3(0.299, 0.587, 0.114);
+const vec3 SEPIA = vec3(1.2, 1.0, 0.8);
+
+/* Source: gamedev.stackexchange.com/a/59808/24839 */
+vec3 rgb2hsv(vec3 c)
+{
+  const vec4 K = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
+  vec4 p = mix(vec4(c.bg, K.wz), vec4(c.gb, K.xy), step(c.b, c.g));
+  vec4 q = mix(vec4(p.xyw, c.r), vec4(c.r, p.yzx), step(p.x, c.r));
+  float d = q.x - min(q.w, q.y);
+  const float eps = 1.0e-10;
+  return vec3(abs(q.z + (q.w - q.y) / (6.0 * d + eps)), d / (q.x + eps), q.x);
+}
+
+vec3 hsv2rgb(vec3 c)
+{
+  const vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
+  vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
+  return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
+}
+
+vec3 thermal(vec3 color)
+{
+  float heat = dot(color, lumaF);
+  vec3 result;
+  result.b = smoothstep(0.5, 0.0, heat);
+  result.r = smoothstep(0.3, 0.7, heat);
+  result.g = smoothstep(0.5, 0.9, heat) * smoothstep(1.0, 0.7, heat);
+  if (heat > 0.9)
+    result.g = heat;
+  return result;
+}
+
+void main()
+{
+  vec4 frag = texture2D(texture, v_texCoord);
+  for (int i = 0; i < MAX_OPS; ++i) {
+    if (i >= opCount)
+      break;
+    float op = ops[i];
+    vec4 param = params[i];
+    if (op < 0.5) {
+      // Gray, param.x is the amount
+      frag.rgb = mix(frag.rgb, vec3(dot(frag.rgb, lumaF)), param.x);
+    } else if (op < 1.5) {
+      // Sepia
+      frag.rgb = mix(frag.rgb, vec3(dot(frag.rgb, lumaF)) * SEPIA, 0.8);
+    } else if (op < 2.5) {
+      // Hue, param.x is the normalized shift
+      vec3 hsv = rgb2hsv(frag.rgb);
+      hsv.x += param.x;
+      frag.rgb = hsv2rgb(hsv);
+    } else if (op < 3.5) {
+      // Thermal
+      frag.rgb = thermal(frag.rgb);
+    } else if (op < 4.5) {
+      // Invert, fully transparent pixels turn black
+      frag = frag.a > 0.0 ? vec4(1.0 - frag.rgb, frag.a) : vec4(0.0);
+    } else if (op < 5.5) {
+      // Grayscale from alpha, param.x is 1 when inverted
+      frag = vec4(vec3(abs(param.x - frag.a)), 1.0);
+    } else {
+      // Color mask, param.rgb is the color and param.a the range
+      float dist = distance(frag.rgb, param.rgb);
+      frag.a *= smoothstep(param.a, param.a + 0.05, dist);
+    }
+    // Every pass used to be stored in 8 bit, so keep the same range
+    frag = clamp(frag, 0.0, 1.0);
+  }
+  gl_FragColor = frag;
+}
@@ -0,0 +1,28 @@
+// Packs the alpha of 32 horizontally adjacent source pixels
+// into one RGBA8 texel, one bit per pixel, lowest bit first
+uniform sampler2D texture;
+uniform highp vec2 sourceSize;
+varying highp vec2 v_texCoord;
+
+float packByte(highp float baseX, highp float y)
+{
+  float value = 0.0;
+  float bit = 1.0;
+  for (int i = 0; i < 8; ++i) {
+    highp float x = baseX + float(i) + 0.5;
+    if (x < sourceSize.x && texture2D(texture, vec2(x, y) / sourceSize).a > 0.0)
+      value += bit;
+    bit *= 2.0;
+  }
+  return value / 255.0;
+}
+
+void main()
+{
+  highp float baseX = floor(v_texCoord.x) * 32.0;
+  highp float y = v_texCoord.y;
+  gl_FragColor = vec4(packByte(baseX, y),
+                      packByte(baseX + 8.0, y),
+                      packByte(baseX + 16.0, y),
+                      packByte(baseX + 24.0, y));
+}
@@ -0,0 +1,20 @@
+/* Dual Kawase blur, downsampling pass */
+
+uniform sampler2D texture;
+/* Half a source texel, scaled by the blur offset */
+uniform vec2 halfPixel;
+
+varying vec2 v_texCoord;
+
+void main()
+{
+	vec2 uv = v_texCoord;
+	vec4 sum = texture2D(texture, uv) * 4.0;
+
+	sum += texture2D(texture, uv - halfPixel);
+	sum += texture2D(texture, uv + halfPixel);
+	sum += texture2D(texture, uv + vec2(halfPixel.x, -halfPixel.y));
+	sum += texture2D(texture, uv - vec2(halfPixel.x, -halfPixel.y));
+
+	gl_FragColor = sum / 8.0;
+}
@@ -0,0 +1,24 @@
+/* Dual Kawase blur, upsampling pass */
+
+uniform sampler2D texture;
+/* Half a source texel, scaled by the blur offset */
+uniform vec2 halfPixel;
+
+varying vec2 v_texCoord;
+
+void main()
+{
+	vec2 uv = v_texCoord;
+	vec2 hp = halfPixel;
+	vec4 sum = texture2D(texture, uv + vec2(-hp.x * 2.0, 0.0));
+
+	sum += texture2D(texture, uv + vec2(-hp.x, hp.y)) * 2.0;
+	sum += texture2D(texture, uv + vec2(0.0, hp.y * 2.0));
+	sum += texture2D(texture, uv + vec2(hp.x, hp.y)) * 2.0;
+	sum += texture2D(texture, uv + vec2(hp.x * 2.0, 0.0));
+	sum += texture2D(texture, uv + vec2(hp.x, -hp.y)) * 2.0;
+	sum += texture2D(texture, uv + vec2(0.0, -hp.y * 2.0));
+	sum += texture2D(texture, uv + vec2(-hp.x, -hp.y)) * 2.0;
+
+	gl_FragColor = sum / 12.0;
+}
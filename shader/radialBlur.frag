@@ -0,0 +1,41 @@
+/* Averages 'samples' copies of the texture rotated around
+ * its center, mirrored at the edges like Bitmap::radialBlur
+ * used to with its five quads */
+
+uniform sampler2D texture;
+uniform vec2 size;
+/* In radians */
+uniform float baseAngle;
+uniform float angleStep;
+uniform int samples;
+
+varying vec2 v_texCoord;
+
+/* Keep in sync with the divisions limit in Bitmap::radialBlur */
+#define MAX_SAMPLES 100
+
+void main()
+{
+	vec2 center = size * 0.5;
+	vec2 pos = v_texCoord * size - center;
+	vec3 rgb = vec3(0.0);
+	float alpha = 0.0;
+
+	for (int i = 0; i < MAX_SAMPLES; ++i)
+	{
+		if (i >= samples)
+			break;
+
+		float rad = baseAngle + float(i) * angleStep;
+		float c = cos(rad);
+		float s = sin(rad);
+		vec2 coord = (vec2(pos.x * c - pos.y * s, pos.x * s + pos.y * c) + center) / size;
+		coord = 1.0 - abs(1.0 - abs(coord));
+
+		vec4 frag = texture2D(texture, coord);
+		rgb += frag.rgb * frag.a;
+		alpha += frag.a;
+	}
+
+	gl_FragColor = vec4(rgb, alpha) / float(samples);
+}
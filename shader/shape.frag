@@ -0,0 +1,64 @@
+
+varying vec2 v_local;
+varying vec2 v_half;
+varying lowp vec4 v_color;
+varying vec4 v_shape;
+
+const float PI = 3.14159265;
+const float sqrt3 = 1.7320508075688772;
+
+/* Same distance functions as rounded_rect, circle,
+ * triangle and polygon.frag, see Bitmap::Shape */
+float rounded_rect_sdf(vec2 p, vec2 b, float r)
+{
+  vec2 d = abs(p) - b + vec2(r);
+  return min(max(d.x, d.y), 0.0) + length(max(d, 0.0)) - r;
+}
+
+vec2 rotate(vec2 p, float rad)
+{
+  float c = cos(rad);
+  float s = sin(rad);
+  return vec2(p.x * c - p.y * s, p.x * s + p.y * c);
+}
+
+float triangle_sdf(vec2 p, float r, float angle)
+{
+  p = rotate(p, radians(angle) + radians(90.0));
+  p.x = abs(p.x);
+  vec2 normal = vec2(sqrt3 * 0.5, 0.5);
+  p.y -= r;
+  return max(dot(p, normal), -p.y - (1.5 * r));
+}
+
+float polygon_sdf(vec2 p, float n, float r, float angle)
+{
+  p = rotate(p, radians(angle));
+  float a = atan(p.x, p.y);
+  float b = PI * 2.0 / n;
+  return cos(floor(0.5 + a / b) * b - a) * length(p) - r;
+}
+
+void main()
+{
+  float type = v_shape.x;
+  float radius = v_shape.y;
+  float alpha;
+  if (type < 0.5) {
+    float d = rounded_rect_sdf(v_local, v_half, radius);
+    float delta = fwidth(d);
+    alpha = smoothstep(delta, -delta, d);
+  } else if (type < 1.5) {
+    // The circle sits in the top left corner of its rectangle
+    float d = length(v_local + v_half - vec2(radius)) - radius;
+    float delta = fwidth(d);
+    alpha = smoothstep(delta, -delta, d);
+  } else if (type < 2.5) {
+    alpha = smoothstep(1.0, 0.0, triangle_sdf(v_local, radius, v_shape.z));
+  } else {
+    alpha = smoothstep(0.5, 0.0, polygon_sdf(v_local, v_shape.w, radius, v_shape.z));
+  }
+  if (alpha <= 0.0)
+    discard;
+  gl_FragColor = vec4(v_color.rgb, v_color.a * alpha);
+}
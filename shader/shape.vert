@@ -0,0 +1,25 @@
+
+uniform mat4 projMat;
+uniform vec2 translation;
+
+attribute vec2 position;
+attribute vec2 texCoord;
+attribute lowp vec4 color;
+attribute vec4 shape;
+
+/* Position relative to the shape's center */
+varying vec2 v_local;
+/* Half its size, every corner is the same distance from the center */
+varying vec2 v_half;
+varying lowp vec4 v_color;
+/* Type, radius, angle, sides */
+varying vec4 v_shape;
+
+void main()
+{
+  gl_Position = projMat * vec4(position + translation, 0, 1);
+  v_local = texCoord;
+  v_half = abs(texCoord);
+  v_color = color;
+  v_shape = shape;
+}
@@ -0,0 +1,30 @@
+
+uniform sampler2D texture;
+varying vec2 v_texCoord;
+uniform vec2 resolution;
+
+/* One pass for every Graphics.snap_to_* and Backdrop effect,
+ * see SnapshotEffect for what each uniform does */
+uniform lowp float gray;
+uniform lowp vec4 tint;
+uniform lowp vec4 c1;
+uniform lowp vec4 c2;
+uniform vec2 origin;
+uniform lowp float gradient;
+uniform lowp float vignette;
+
+const vec3 lumaF = vec3(0.299, 0.587, 0.114);
+
+void main()
+{
+  vec4 frag = texture2D(texture, v_texCoord);
+  float luma = dot(frag.rgb, lumaF);
+  frag.rgb = mix(frag.rgb, vec3(luma), gray);
+  frag.rgb = mix(frag.rgb, vec3(luma) * tint.rgb, tint.a);
+  vec2 st = gl_FragCoord.xy / resolution;
+  vec4 grad = mix(c1, c2, distance(st, origin));
+  frag = mix(frag, grad, gradient);
+  float edge = smoothstep(0.5, 0.48, length(st - vec2(0.5)));
+  frag.rgb = frag.rgb - (1.0 - edge) * vignette;
+  gl_FragColor = frag;
+}
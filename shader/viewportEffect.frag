@@ -0,0 +1,28 @@
+/* Applies a viewport's tone, color and flash in one pass,
+ * in the order ScreenScene used to draw them separately */
+
+uniform sampler2D texture;
+/* rgb is added or substracted, w is the gray amount */
+uniform vec4 tone;
+uniform lowp vec4 color;
+uniform lowp vec4 flash;
+
+varying vec2 v_texCoord;
+
+const vec3 lumaF = vec3(.299, .587, .114);
+
+void main()
+{
+	vec4 frag = texture2D(texture, v_texCoord);
+
+	float luma = dot(frag.rgb, lumaF);
+	frag.rgb = mix(frag.rgb, vec3(luma), tone.w);
+
+	frag.rgb = clamp(frag.rgb + max(tone.rgb, 0.0), 0.0, 1.0);
+	frag.rgb = clamp(frag.rgb - max(-tone.rgb, 0.0), 0.0, 1.0);
+
+	frag.rgb = mix(frag.rgb, color.rgb, color.a);
+	frag.rgb = mix(frag.rgb, flash.rgb, flash.a);
+
+	gl_FragColor = frag;
+}
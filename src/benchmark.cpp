@@ -0,0 +1,145 @@
+/*
+** benchmark.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "benchmark.h"
+#include <SDL_timer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "debugwriter.h"
+
+static bool running = false;
+static int frameLimit = 0;
+static std::string report;
+static unsigned long long simTime = 0;
+// Ticks left over from the last whole microsecond step
+static unsigned long long simRemainder = 0;
+// Stays 0 until the first frame got presented
+static uint64_t lastSwap = 0;
+// Real duration of every frame in microseconds
+static std::vector<uint32_t> frameTimes;
+static unsigned long long totalDraws = 0;
+static unsigned long long totalUploads = 0;
+
+static double percentile(const std::vector<uint32_t> &sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  size_t i = (size_t) (p * (sorted.size() - 1) + 0.5);
+  return sorted[i] / 1000.0;
+}
+
+namespace Benchmark
+{
+
+void start(int frames, const std::string &reportPath)
+{
+  running = true;
+  frameLimit = frames;
+  report = reportPath;
+  simTime = 0;
+  simRemainder = 0;
+  frameTimes.clear();
+  frameTimes.reserve(frames ? frames : 3600);
+  totalDraws = 0;
+  totalUploads = 0;
+  lastSwap = 0;
+}
+
+bool active()
+{
+  return running;
+}
+
+unsigned long long runTime()
+{
+  return simTime;
+}
+
+bool endFrame(int frameRate, unsigned int draws, unsigned int uploads)
+{
+  if (!running)
+    return false;
+  static const uint64_t freq = SDL_GetPerformanceFrequency();
+  uint64_t now = SDL_GetPerformanceCounter();
+  /* The first frame also covers loading the scripts and
+   * whatever they set up, timing starts once it's out */
+  if (lastSwap) {
+    frameTimes.push_back((now - lastSwap) * 1000000 / freq);
+    totalDraws += draws;
+    totalUploads += uploads;
+  }
+  lastSwap = now;
+  // Carry the remainder so 1000000 / frameRate doesn't drift
+  simRemainder += 1000000;
+  simTime += simRemainder / frameRate;
+  simRemainder %= frameRate;
+  return frameLimit && (int) frameTimes.size() >= frameLimit;
+}
+
+bool finish()
+{
+  if (!running)
+    return false;
+  running = false;
+  FILE *f = fopen(report.c_str(), "w");
+  if (!f) {
+    Debug() << "Could not write benchmark report" << report;
+    return false;
+  }
+  std::vector<uint32_t> sorted(frameTimes);
+  std::sort(sorted.begin(), sorted.end());
+  size_t count = sorted.size();
+  unsigned long long total = 0;
+  for (size_t i = 0; i < count; ++i)
+    total += sorted[i];
+  double mean = count ? total / 1000.0 / count : 0;
+  fprintf(f, "{\n"
+             "  \"frames\": %u,\n"
+             "  \"total_ms\": %.3f,\n"
+             "  \"mean_ms\": %.3f,\n"
+             "  \"fps\": %.2f,\n"
+             "  \"min_ms\": %.3f,\n"
+             "  \"p50_ms\": %.3f,\n"
+             "  \"p90_ms\": %.3f,\n"
+             "  \"p95_ms\": %.3f,\n"
+             "  \"p99_ms\": %.3f,\n"
+             "  \"max_ms\": %.3f,\n"
+             "  \"draw_calls\": %llu,\n"
+             "  \"draw_calls_per_frame\": %.2f,\n"
+             "  \"texture_uploads\": %llu,\n"
+             "  \"texture_uploads_per_frame\": %.2f\n"
+             "}\n",
+          (unsigned) count, total / 1000.0, mean, mean > 0 ? 1000.0 / mean : 0,
+          count ? sorted[0] / 1000.0 : 0,
+          percentile(sorted, 0.5), percentile(sorted, 0.9),
+          percentile(sorted, 0.95), percentile(sorted, 0.99),
+          count ? sorted[count - 1] / 1000.0 : 0,
+          totalDraws, count ? (double) totalDraws / count : 0,
+          totalUploads, count ? (double) totalUploads / count : 0);
+  fclose(f);
+  Debug() << "Benchmark report written to" << report;
+  return true;
+}
+
+}
@@ -0,0 +1,47 @@
+/*
+** benchmark.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+
+/* Reproducible frame timings for a given scene. While running,
+ * the game clock advances by exactly one frame per presented
+ * frame instead of following the wall clock, so scripts see the
+ * same timestep on every run whatever the machine. The real
+ * time each frame took is what ends up in the report */
+namespace Benchmark
+{
+  // 'frames' of 0 keeps running until finish() gets called
+  void start(int frames, const std::string &reportPath);
+  bool active();
+  // Simulated time since start() in microseconds
+  unsigned long long runTime();
+  /* Called once per presented frame with the frame rate the game
+   * runs at and the GL calls it made, true once the run is over */
+  bool endFrame(int frameRate, unsigned int draws, unsigned int uploads);
+  // Writes the JSON report and stops, false if it can't be written
+  bool finish();
+}
+
+#endif // BENCHMARK_H
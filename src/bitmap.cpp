@@ -36,7 +36,10 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "texpool.h"
+#include "imagecache.h"
+#include "imageloader.h"
 #include "shader.h"
+#include "scene.h"
 #include "filesystem.h"
 #include "font.h"
 #include "eventthread.h"
@@ -60,10 +63,16 @@ else*/
 //endif */
 // End of addition
 #define PI 3.14159265358979323846f
+/* Size of the aligned block read back around a queried pixel,
+ * so neighbouring reads don't each cost a GPU round trip */
+#define SURFACE_TILE 64
+// Most halvings blur(radius) goes through, enough for radius 128
+#define BLUR_MAX_LEVELS 6
 
 #define GUARD_MEGA \
 { \
-  if (p->megaSurface) \
+  p->ensureLoaded(); \
+  if (!p->megaTiles.empty()) \
     throw Exception(Exception::HiddenChestError, \
                     "Operation not supported for mega surfaces"); \
 }
@@ -115,14 +124,15 @@ struct BitmapPrivate
   Bitmap *self;
   TEXFBO tex_gl;
   Font *font;
-  /* "Mega surfaces" are a hack to allow Tilesets to be used
-   * whose Bitmaps don't fit into a regular texture. They're
-   * kept in RAM and will throw an error if they're used in
-   * any context other than as Tilesets */
-  SDL_Surface *megaSurface;
+  /* "Mega surfaces" are Bitmaps that don't fit into a regular
+   * texture, such as tall tilesets. They're split into a grid of
+   * textures, row by row. They can be blitted from, drawn by
+   * Sprites and used as Tilesets, anything else throws an error */
+  std::vector<TEXFBO> megaTiles;
+  Vec2i megaSize;
   /* A cached version of the bitmap in client memory, for
-   * getPixel calls. Is invalidated any time the bitmap
-   * is modified */
+   * getPixel calls. Modifications only mark the area they
+   * touched as stale, see 'staleSurface' */
   SDL_Surface *surface;
   SDL_PixelFormat *format;
   /* The 'tainted' area describes which parts of the
@@ -132,18 +142,56 @@ struct BitmapPrivate
    * in the texture and blit to it directly, saving
    * ourselves the expensive blending calculation */
   pixman_region16_t tainted;
-
-  BitmapPrivate(Bitmap *self) : self(self), megaSurface(0), surface(0)
+  /* The parts known to have an alpha of 1. Blending onto them keeps
+   * it that way, which reduces the RGSS blending formula to what
+   * glBlendFuncSeparate can do without a copy of the destination.
+   * Anything modifying a part of the bitmap drops it from here
+   * unless it knows better, see onModified() */
+  pixman_region16_t solid;
+  /* The parts of 'surface' that no longer match the texture.
+   * They're only read back once a pixel inside them is asked for */
+  pixman_region16_t staleSurface;
+  /* One bit per pixel, set wherever alpha isn't 0, with rows
+   * padded to 32 pixels. Serves the alpha hit tests and gets
+   * rebuilt on the GPU the first time one is done after the
+   * bitmap was modified */
+  std::vector<uint8_t> hitMask;
+  bool hitMaskValid;
+  /* Set while 'tex_gl' is shared through the image cache
+   * with other Bitmaps loaded from the same file */
+  ImageCacheEntry *cached;
+  /* Set while the image loader is still decoding the file
+   * of an asynchronously loaded Bitmap, which has no texture
+   * until then */
+  ImageLoadJob *pending;
+  /* Set while the Bitmap lives in one of the shared atlas pages
+   * instead of 'tex_gl', which then only keeps the size. Drawing
+   * and blitting from it and reading pixels use the page directly,
+   * anything else moves it back into a texture of its own */
+  AtlasSlot atlas;
+  sigc::connection prepareCon;
+
+  BitmapPrivate(Bitmap *self)
+  : self(self), surface(0), cached(0), pending(0),
+    hitMaskValid(false)
   {
     format = SDL_AllocFormat(SDL_PIXELFORMAT_ABGR8888);
     font = &shState->defaultFont();
     pixman_region_init(&tainted);
+    pixman_region_init(&solid);
+    pixman_region_init(&staleSurface);
   }
 
   ~BitmapPrivate()
   {
+    prepareCon.disconnect();
+    if (pending)
+      shState->imageLoader().cancel(pending);
+    SDL_FreeSurface(surface);
     SDL_FreeFormat(format);
     pixman_region_fini(&tainted);
+    pixman_region_fini(&solid);
+    pixman_region_fini(&staleSurface);
   }
 
   void allocSurface()
@@ -154,6 +202,145 @@ struct BitmapPrivate
                                    format->Bmask, format->Amask);
   }
 
+  void shareCached(ImageCacheEntry *entry)
+  {
+    cached = entry;
+    tex_gl = ImageCache::texture(entry);
+  }
+
+  bool inAtlas() const
+  {
+    return atlas.pageIndex >= 0;
+  }
+
+  void leaveAtlas()
+  {
+    if (!inAtlas())
+      return;
+    TEXFBO own = shState->texPool().request(tex_gl.width, tex_gl.height);
+    GLMeta::blitBegin(own);
+    GLMeta::blitSource(*atlas.page);
+    GLMeta::blitRectangle(atlas.rect, Vec2i());
+    GLMeta::blitEnd();
+    shState->texPool().atlasFree(atlas);
+    tex_gl = own;
+  }
+  // Shared textures are copied before anything gets drawn into them
+  void ensureOwnTexture()
+  {
+    leaveAtlas();
+    if (!cached)
+      return;
+    TEXFBO own = shState->texPool().request(tex_gl.width, tex_gl.height);
+    GLMeta::blitBegin(own);
+    GLMeta::blitSource(tex_gl);
+    GLMeta::blitRectangle(IntRect(0, 0, tex_gl.width, tex_gl.height), Vec2i());
+    GLMeta::blitEnd();
+    shState->imageCache().release(cached);
+    cached = 0;
+    tex_gl = own;
+  }
+
+  void ensureLoaded()
+  {
+    if (pending)
+      finishLoading();
+  }
+  // Uploads finished decodes without ever waiting for the worker
+  void pollLoading()
+  {
+    if (shState->imageLoader().isDone(pending))
+      finishLoading();
+  }
+
+  void finishLoading()
+  {
+    ImageLoader &loader = shState->imageLoader();
+    std::string filename = ImageLoader::filename(pending);
+    std::string error;
+    SDL_Surface *imgSurf = loader.take(pending, error);
+    pending = 0;
+    prepareCon.disconnect();
+    if (!imgSurf) {
+      /* Whoever touches the Bitmap first may be drawing,
+       * so end up with a stub instead of throwing */
+      Debug() << error;
+      tex_gl = shState->texPool().request(32, 32);
+      fillRect(IntRect(0, 0, 32, 32), Vec4());
+      onModified();
+      return;
+    }
+    if (imgSurf->w > glState.caps.maxTexSize || imgSurf->h > glState.caps.maxTexSize) {
+      uploadMega(imgSurf);
+    } else {
+      TEXFBO tex;
+      try {
+        tex = shState->texPool().request(imgSurf->w, imgSurf->h);
+      } catch (const Exception &e) {
+        SDL_FreeSurface(imgSurf);
+        throw e;
+      }
+      TEX::bind(tex.tex);
+      GLMeta::streamSubImage(0, 0, tex.width, tex.height, imgSurf->pixels, GL_RGBA);
+      SDL_FreeSurface(imgSurf);
+      shareCached(shState->imageCache().insert(filename.c_str(), 0, tex));
+    }
+    addTaintedArea(IntRect(0, 0, self->width(), self->height()));
+    onModified();
+  }
+
+  // Splits 'surf' into tiles the hardware can handle and frees it
+  void uploadMega(SDL_Surface *surf)
+  {
+    int maxSize = glState.caps.maxTexSize;
+    megaSize = Vec2i(surf->w, surf->h);
+    try {
+      for (int y = 0; y < surf->h; y += maxSize) {
+        for (int x = 0; x < surf->w; x += maxSize) {
+          int w = std::min(maxSize, surf->w - x);
+          int h = std::min(maxSize, surf->h - y);
+          megaTiles.push_back(shState->texPool().request(w, h));
+          TEX::bind(megaTiles.back().tex);
+          GLMeta::subRectImageUpload(surf->w, x, y, 0, 0, w, h, surf, GL_RGBA);
+        }
+      }
+    } catch (const Exception &e) {
+      GLMeta::subRectImageEnd();
+      SDL_FreeSurface(surf);
+      releaseMega();
+      throw e;
+    }
+    GLMeta::subRectImageEnd();
+    SDL_FreeSurface(surf);
+  }
+
+  void releaseMega()
+  {
+    for (size_t i = 0; i < megaTiles.size(); ++i)
+      shState->texPool().release(megaTiles[i]);
+    megaTiles.clear();
+  }
+
+  // Position and size of mega tile 'index' within the Bitmap
+  IntRect megaTileArea(int index) const
+  {
+    int maxSize = glState.caps.maxTexSize;
+    int cols = (megaSize.x + maxSize - 1) / maxSize;
+    const TEXFBO &tile = megaTiles[index];
+    return IntRect((index % cols) * maxSize, (index / cols) * maxSize,
+                   tile.width, tile.height);
+  }
+
+  void releaseTexture()
+  {
+    if (cached) {
+      shState->imageCache().release(cached);
+      cached = 0;
+    } else {
+      shState->texPool().release(tex_gl);
+    }
+  }
+
   void clearTaintedArea()
   {
     pixman_region_fini(&tainted);
@@ -171,10 +358,36 @@ struct BitmapPrivate
     if (!touchesTaintedArea(rect)) return;
     pixman_region16_t m_reg;
     pixman_region_init_rect(&m_reg, rect.x, rect.y, rect.w, rect.h);
-    pixman_region_subtract(&tainted, &m_reg, &tainted);
+    pixman_region_subtract(&tainted, &tainted, &m_reg);
     pixman_region_fini(&m_reg);
   }
 
+  void addSolidArea(const IntRect &rect)
+  {
+    IntRect norm = normalizedRect(rect);
+    pixman_region_union_rect(&solid, &solid, norm.x, norm.y, norm.w, norm.h);
+  }
+
+  void substractSolidArea(const IntRect &rect)
+  {
+    IntRect norm = normalizedRect(rect);
+    pixman_region16_t m_reg;
+    pixman_region_init_rect(&m_reg, norm.x, norm.y, norm.w, norm.h);
+    pixman_region_subtract(&solid, &solid, &m_reg);
+    pixman_region_fini(&m_reg);
+  }
+
+  bool insideSolidArea(const IntRect &rect)
+  {
+    IntRect norm = normalizedRect(rect);
+    pixman_box16_t box;
+    box.x1 = norm.x;
+    box.y1 = norm.y;
+    box.x2 = norm.x + norm.w;
+    box.y2 = norm.y + norm.h;
+    return pixman_region_contains_rectangle(&solid, &box) == PIXMAN_REGION_IN;
+  }
+
   bool touchesTaintedArea(const IntRect &rect)
   {
     pixman_box16_t box;
@@ -198,6 +411,71 @@ struct BitmapPrivate
     FBO::bind(tex_gl.fbo);
   }
 
+  /* Draws 'sourceRect' of 'source' into 'destRect', scaling as
+   * needed. True if the destination got blended with, so its alpha
+   * can only have grown; false if it was overwritten */
+  bool stretchFrom(TEXFBO &source, const IntRect &destRect,
+                   const IntRect &sourceRect, int opacity)
+  {
+    if (opacity == 255 && !touchesTaintedArea(destRect)) {
+      // Fast blit
+      GLMeta::blitBegin(tex_gl);
+      GLMeta::blitSource(source);
+      GLMeta::blitRectangle(sourceRect, destRect);
+      GLMeta::blitEnd();
+      return false;
+    }
+    float normOpacity = (float) opacity / 255.0f;
+    bool cleared = !touchesTaintedArea(destRect);
+    if (cleared || insideSolidArea(destRect)) {
+      /* Over cleared pixels the result is the source with its alpha
+       * scaled by 'opacity', over solid ones it's plain alpha blending.
+       * Either way the destination doesn't need to be sampled */
+      SimpleAlphaShader &shader = shState->shaders().simpleAlpha;
+      shader.bind();
+      shader.setTranslation(Vec2i());
+      shader.setTexSize(Vec2i(source.width, source.height));
+      Quad &quad = shState->gpQuad();
+      quad.setTexPosRect(sourceRect, destRect);
+      quad.setColor(Vec4(1, 1, 1, normOpacity));
+      TEX::bind(source.tex);
+      bindFBO();
+      pushSetViewport(shader);
+      glState.blendMode.pushSet(BlendNormal);
+      glState.blend.pushSet(!cleared);
+      quad.draw();
+      glState.blend.pop();
+      glState.blendMode.pop();
+      popViewport();
+      return !cleared;
+    }
+    // Fragment pipeline
+    TEXFBO &gpTex = shState->gpTexFBO(destRect.w, destRect.h);
+    GLMeta::blitBegin(gpTex);
+    GLMeta::blitSource(tex_gl);
+    GLMeta::blitRectangle(destRect, Vec2i());
+    GLMeta::blitEnd();
+    FloatRect bltSubRect((float) sourceRect.x / source.width,
+                         (float) sourceRect.y / source.height,
+                         ((float) source.width / sourceRect.w) * ((float) destRect.w / gpTex.width),
+                         ((float) source.height / sourceRect.h) * ((float) destRect.h / gpTex.height));
+    BltShader &shader = shState->shaders().blt;
+    shader.bind();
+    shader.setDestination(gpTex.tex);
+    shader.setSubRect(bltSubRect);
+    shader.setOpacity(normOpacity);
+    Quad &quad = shState->gpQuad();
+    quad.setTexPosRect(sourceRect, destRect);
+    quad.setColor(Vec4(1, 1, 1, normOpacity));
+    TEX::bind(source.tex);
+    shader.setTexSize(Vec2i(source.width, source.height));
+    bindFBO();
+    pushSetViewport(shader);
+    blitQuad(quad);
+    popViewport();
+    return true;
+  }
+
   void pushSetViewport(ShaderBase &shader) const
   {
     glState.viewport.pushSet(IntRect(0, 0, tex_gl.width, tex_gl.height));
@@ -216,6 +494,35 @@ struct BitmapPrivate
     glState.blend.pop();
   }
 
+  /* Runs the bound 'shader' over the whole texture. It renders into
+   * the shared scratch texture and gets copied back, so a new texture
+   * is only requested if this Bitmap didn't have one of its own */
+  void filterPass(ShaderBase &shader, const Vec4 &color = Vec4(1, 1, 1, 1))
+  {
+    leaveAtlas();
+    int w = tex_gl.width, h = tex_gl.height;
+    TEXFBO &scratch = shState->gpTexFBO(w, h);
+    FloatRect texRect(0, 0, w, h);
+    Quad &quad = shState->gpQuad();
+    quad.setTexPosRect(texRect, texRect);
+    quad.setColor(color);
+    FBO::bind(scratch.fbo);
+    pushSetViewport(shader);
+    bindTexture(shader);
+    blitQuad(quad);
+    popViewport();
+    TEX::unbind();
+    if (cached) {
+      shState->imageCache().release(cached);
+      cached = 0;
+      tex_gl = shState->texPool().request(w, h);
+    }
+    GLMeta::blitBegin(tex_gl);
+    GLMeta::blitSource(scratch);
+    GLMeta::blitRectangle(IntRect(0, 0, w, h), Vec2i());
+    GLMeta::blitEnd();
+  }
+
   void fillRect(const IntRect &rect, const Vec4 &color)
   {
     bindFBO();
@@ -322,12 +629,154 @@ struct BitmapPrivate
     surf = surfConv;
   }
 
-  void onModified(bool freeSurface = true)
+  void markSurfaceStale(const IntRect &rect)
   {
-    if (surface && freeSurface) {
-      SDL_FreeSurface(surface);
-      surface = 0;
+    IntRect norm = normalizedRect(rect);
+    int x1 = std::max(norm.x, 0), y1 = std::max(norm.y, 0);
+    int x2 = std::min(norm.x + norm.w, surface->w);
+    int y2 = std::min(norm.y + norm.h, surface->h);
+    if (x1 < x2 && y1 < y2)
+      pixman_region_union_rect(&staleSurface, &staleSurface, x1, y1, x2 - x1, y2 - y1);
+  }
+
+  // 'origin' is where the Bitmap starts in the bound framebuffer
+  void readSurfaceRect(const pixman_box16_t &box, const Vec2i &origin)
+  {
+    int w = box.x2 - box.x1, h = box.y2 - box.y1;
+    int x = origin.x + box.x1, y = origin.y + box.y1;
+    uint8_t *dst = (uint8_t*) surface->pixels + box.y1 * surface->pitch + box.x1 * 4;
+    if (w == surface->w) {
+      gl.ReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, dst);
+    } else if (gl.pack_subimage) {
+      gl.PixelStorei(GL_PACK_ROW_LENGTH, surface->w);
+      gl.ReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, dst);
+      gl.PixelStorei(GL_PACK_ROW_LENGTH, 0);
+    } else {
+      std::vector<uint8_t> rows(w * h * 4);
+      gl.ReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, &rows[0]);
+      for (int y = 0; y < h; ++y)
+        memcpy(dst + y * surface->pitch, &rows[y * w * 4], w * 4);
+    }
+  }
+  // Brings the part of 'surface' inside 'rect' up to date
+  void syncSurface(const IntRect &rect)
+  {
+    if (!surface) {
+      allocSurface();
+      pixman_region_fini(&staleSurface);
+      pixman_region_init_rect(&staleSurface, 0, 0, surface->w, surface->h);
     }
+    if (!pixman_region_not_empty(&staleSurface))
+      return;
+    pixman_region16_t wanted;
+    pixman_region_init_rect(&wanted, rect.x, rect.y, rect.w, rect.h);
+    pixman_region_intersect(&wanted, &wanted, &staleSurface);
+    int n;
+    pixman_box16_t *boxes = pixman_region_rectangles(&wanted, &n);
+    if (n > 0) {
+      FBO::bind(inAtlas() ? atlas.page->fbo : tex_gl.fbo);
+      Vec2i origin = inAtlas() ? atlas.rect.pos() : Vec2i();
+      for (int i = 0; i < n; ++i)
+        readSurfaceRect(boxes[i], origin);
+      pixman_region_subtract(&staleSurface, &staleSurface, &wanted);
+    }
+    pixman_region_fini(&wanted);
+  }
+
+  void syncSurfaceAt(int x, int y)
+  {
+    int tx = x - x % SURFACE_TILE, ty = y - y % SURFACE_TILE;
+    syncSurface(IntRect(tx, ty, SURFACE_TILE, SURFACE_TILE));
+  }
+
+  int hitMaskPitch() const
+  {
+    return ((tex_gl.width + 31) / 32) * 4;
+  }
+
+  // Atlas pages aren't laid out for the packing shader
+  void buildHitMaskFromSurface()
+  {
+    syncSurface(IntRect(0, 0, tex_gl.width, tex_gl.height));
+    int pitch = hitMaskPitch();
+    hitMask.assign(pitch * tex_gl.height, 0);
+    for (int y = 0; y < tex_gl.height; ++y) {
+      const uint32_t *row = (const uint32_t*) ((uint8_t*) surface->pixels + y * surface->pitch);
+      for (int x = 0; x < tex_gl.width; ++x)
+        if (row[x] & format->Amask)
+          hitMask[y * pitch + (x >> 3)] |= 1 << (x & 7);
+    }
+    hitMaskValid = true;
+  }
+
+  void buildHitMask()
+  {
+    if (inAtlas()) {
+      buildHitMaskFromSurface();
+      return;
+    }
+    int packedW = (tex_gl.width + 31) / 32;
+    int h = tex_gl.height;
+    TEXFBO packed = shState->texPool().request(packedW, h);
+    HitMaskShader &shader = shState->shaders().hit_mask;
+    shader.bind();
+    shader.setTranslation(Vec2i());
+    // Texture coordinates are given in packed texels
+    shader.setTexSize(Vec2i(1, 1));
+    shader.setSourceSize(Vec2i(tex_gl.width, h));
+    TEX::bind(tex_gl.tex);
+    FBO::bind(packed.fbo);
+    glState.viewport.pushSet(IntRect(0, 0, packedW, h));
+    shader.applyViewportProj();
+    Quad &quad = shState->gpQuad();
+    FloatRect rect(0, 0, packedW, h);
+    quad.setTexPosRect(rect, rect);
+    blitQuad(quad);
+    hitMask.resize(packedW * 4 * h);
+    gl.ReadPixels(0, 0, packedW, h, GL_RGBA, GL_UNSIGNED_BYTE, &hitMask[0]);
+    glState.viewport.pop();
+    shState->texPool().release(packed);
+    hitMaskValid = true;
+  }
+
+  bool isOpaqueAt(int x, int y)
+  {
+    if (!hitMaskValid)
+      buildHitMask();
+    return hitMask[y * hitMaskPitch() + (x >> 3)] & (1 << (x & 7));
+  }
+
+  void setOpaqueAt(int x, int y, bool opaque)
+  {
+    uint8_t &bits = hitMask[y * hitMaskPitch() + (x >> 3)];
+    if (opaque)
+      bits |= 1 << (x & 7);
+    else
+      bits &= ~(1 << (x & 7));
+  }
+  /* Passing false means the caller already patched the
+   * client side copies (surface and hit mask) itself */
+  void onModified(bool copiesStale = true)
+  {
+    pixman_region_fini(&solid);
+    pixman_region_init(&solid);
+    if (copiesStale) {
+      if (surface)
+        markSurfaceStale(IntRect(0, 0, surface->w, surface->h));
+      hitMaskValid = false;
+    }
+    Scene::markChanged();
+    self->modified();
+  }
+  // Only 'rect' of the client side copies needs to be read back again
+  void onModified(const IntRect &rect, bool keepSolid = false)
+  {
+    if (!keepSolid)
+      substractSolidArea(rect);
+    if (surface)
+      markSurfaceStale(rect);
+    hitMaskValid = false;
+    Scene::markChanged();
     self->modified();
   }
 };
@@ -346,6 +795,14 @@ struct BitmapOpenHandler : FileSystem::OpenHandler
 
 Bitmap::Bitmap(const char *filename)
 {
+  ImageCache &cache = shState->imageCache();
+  ImageCacheEntry *entry = cache.acquire(filename);
+  if (entry) {
+    p = new BitmapPrivate(this);
+    p->shareCached(entry);
+    p->addTaintedArea(rect());
+    return;
+  }
   BitmapOpenHandler handler;
   shState->fileSystem().openRead(handler, filename);
   SDL_Surface *imgSurf = handler.surf;
@@ -358,8 +815,12 @@ Bitmap::Bitmap(const char *filename)
   if (imgSurf->w > glState.caps.maxTexSize || imgSurf->h > glState.caps.maxTexSize) {
     // Mega surface
     p = new BitmapPrivate(this);
-    p->megaSurface = imgSurf;
-    SDL_SetSurfaceBlendMode(p->megaSurface, SDL_BLENDMODE_NONE);
+    try {
+      p->uploadMega(imgSurf);
+    } catch (const Exception &e) {
+      delete p;
+      throw e;
+    }
   } else { // Regular surface
     TEXFBO tex;
     try {
@@ -371,12 +832,64 @@ Bitmap::Bitmap(const char *filename)
     p = new BitmapPrivate(this);
     p->tex_gl = tex;
     TEX::bind(p->tex_gl.tex);
-    TEX::uploadImage(p->tex_gl.width, p->tex_gl.height, imgSurf->pixels, GL_RGBA);
+    GLMeta::streamSubImage(0, 0, p->tex_gl.width, p->tex_gl.height,
+                           imgSurf->pixels, GL_RGBA);
     SDL_FreeSurface(imgSurf);
+    p->shareCached(cache.insert(filename, 0, p->tex_gl));
   }
   p->addTaintedArea(rect());
 }
 
+Bitmap::Bitmap(ImageCacheEntry *entry)
+{
+  p = new BitmapPrivate(this);
+  p->shareCached(entry);
+  p->addTaintedArea(rect());
+}
+
+Bitmap::Bitmap(ImageLoadJob *job)
+{
+  p = new BitmapPrivate(this);
+  p->pending = job;
+  p->prepareCon = shState->prepareDraw.connect
+    (sigc::mem_fun(p, &BitmapPrivate::pollLoading));
+}
+
+Bitmap *Bitmap::loadAsync(const char *filename)
+{
+  ImageCacheEntry *entry = shState->imageCache().acquire(filename);
+  if (entry)
+    return new Bitmap(entry);
+  return new Bitmap(shState->imageLoader().enqueue(filename));
+}
+
+bool Bitmap::isLoaded() const
+{
+  guardDisposed();
+  return !p->pending || shState->imageLoader().isDone(p->pending);
+}
+
+Bitmap *Bitmap::cached(const char *filename, int hue)
+{
+  hue = ((hue % 360) + 360) % 360;
+  if (hue == 0)
+    return new Bitmap(filename);
+  ImageCache &cache = shState->imageCache();
+  ImageCacheEntry *entry = cache.acquire(filename, hue);
+  if (entry)
+    return new Bitmap(entry);
+  Bitmap *b = new Bitmap(filename);
+  // Mega surfaces can't change their hue and raise here
+  try {
+    b->hueChange(hue);
+  } catch (...) {
+    delete b;
+    throw;
+  }
+  b->p->shareCached(cache.insert(filename, hue, b->p->tex_gl));
+  return b;
+}
+
 Bitmap::Bitmap(const char *filename, int none)
 {
   IntBitmap ib;
@@ -433,13 +946,24 @@ Bitmap::Bitmap(int width, int height)
   TEXFBO tex = shState->texPool().request(width, height);
   p = new BitmapPrivate(this);
   p->tex_gl = tex;
-  clear();
+  /* Not clear(), nothing shows a brand new Bitmap yet so the
+   * screen hasn't changed, eg. back to back snapshots can still
+   * reuse the scene composited for the first one */
+  p->bindFBO();
+  glState.clearColor.pushSet(Vec4());
+  FBO::clear();
+  glState.clearColor.pop();
 }
 
 Bitmap::Bitmap(const Bitmap &other)
 {
   other.ensureNonMega();
   p = new BitmapPrivate(this);
+  if (other.p->cached) {
+    p->shareCached(shState->imageCache().retain(other.p->cached));
+    p->addTaintedArea(rect());
+    return;
+  }
   p->tex_gl = shState->texPool().request(other.width(), other.height());
   blt(0, 0, other, rect());
 }
@@ -452,16 +976,18 @@ Bitmap::~Bitmap()
 int Bitmap::width() const
 {
   guardDisposed();
-  if (p->megaSurface)
-    return p->megaSurface->w;
+  p->ensureLoaded();
+  if (!p->megaTiles.empty())
+    return p->megaSize.x;
   return p->tex_gl.width;
 }
 
 int Bitmap::height() const
 {
   guardDisposed();
-  if (p->megaSurface)
-    return p->megaSurface->h;
+  p->ensureLoaded();
+  if (!p->megaTiles.empty())
+    return p->megaSize.y;
   return p->tex_gl.height;
 }
 
@@ -504,92 +1030,58 @@ void Bitmap::stretchBlt(const IntRect &destRect,
   opacity = clamp(opacity, 0, 255);
   if (opacity == 0)
     return;
-  SDL_Surface *srcSurf = source.megaSurface();
-  if (srcSurf && shState->config().subImageFix) {
-    // Blit from software surface, for broken GL drivers
-    Vec2i gpTexSize;
-    shState->ensureTexSize(sourceRect.w, sourceRect.h, gpTexSize);
-    shState->bindTex();
-    GLMeta::subRectImageUpload(srcSurf->w, sourceRect.x, sourceRect.y, 0, 0,
-                               sourceRect.w, sourceRect.h, srcSurf, GL_RGBA);
-    GLMeta::subRectImageEnd();
-    SimpleShader &shader = shState->shaders().simple;
-    shader.bind();
-    shader.setTranslation(Vec2i());
-    shader.setTexSize(gpTexSize);
-    p->pushSetViewport(shader);
-    p->bindFBO();
-    Quad &quad = shState->gpQuad();
-    quad.setTexRect(FloatRect(0, 0, sourceRect.w, sourceRect.h));
-    quad.setPosRect(destRect);
-    p->blitQuad(quad);
-    p->popViewport();
-    p->addTaintedArea(destRect);
-    p->onModified();
-    return;
-  } else if (srcSurf) {
-    // Blit from software surface - Don't do transparent blits for now
-    if (opacity < 255)
-      source.ensureNonMega();
-    SDL_Rect srcRect = sourceRect;
-    SDL_Rect dstRect = destRect;
-    SDL_Rect btmRect = { 0, 0, width(), height() };
-    SDL_Rect bltRect;
-    if (SDL_IntersectRect(&btmRect, &dstRect, &bltRect) != SDL_TRUE)
-      return;
-    int bpp;
-    Uint32 rMask, gMask, bMask, aMask;
-    SDL_PixelFormatEnumToMasks(SDL_PIXELFORMAT_ABGR8888,
-                               &bpp, &rMask, &gMask, &bMask, &aMask);
-    SDL_Surface *blitTemp =
-      SDL_CreateRGBSurface(0, destRect.w, destRect.h, bpp, rMask, gMask, bMask, aMask);
-    SDL_BlitScaled(srcSurf, &srcRect, blitTemp, 0);
-    TEX::bind(p->tex_gl.tex);
-    if (bltRect.w == dstRect.w && bltRect.h == dstRect.h)
-    { // Dest rectangle lies within bounding box
-      TEX::uploadSubImage(destRect.x, destRect.y, destRect.w, destRect.h, blitTemp->pixels, GL_RGBA);
-    } else { // Clipped blit
-      GLMeta::subRectImageUpload(blitTemp->w, bltRect.x - dstRect.x, bltRect.y - dstRect.y,
-                                 bltRect.x, bltRect.y, bltRect.w, bltRect.h, blitTemp, GL_RGBA);
-      GLMeta::subRectImageEnd();
-    }
-    SDL_FreeSurface(blitTemp);
-    p->onModified();
-    return;
+  p->ensureOwnTexture();
+  source.p->ensureLoaded();
+  if (source.p->inAtlas()) {
+    // Reaching outside the Bitmap would pick up its atlas neighbours
+    IntRect norm = normalizedRect(sourceRect);
+    IntRect bounds(0, 0, source.p->tex_gl.width, source.p->tex_gl.height);
+    SDL_Rect inside;
+    if (!SDL_IntersectRect(&norm, &bounds, &inside) ||
+        inside.w != norm.w || inside.h != norm.h)
+      source.p->leaveAtlas();
   }
-  if (opacity == 255 && !p->touchesTaintedArea(destRect)) {
-    // Fast blit
-    GLMeta::blitBegin(p->tex_gl);
-    GLMeta::blitSource(source.p->tex_gl);
-    GLMeta::blitRectangle(sourceRect, destRect);
-    GLMeta::blitEnd();
-  } else { // Fragment pipeline
-    float normOpacity = (float) opacity / 255.0f;
-    TEXFBO &gpTex = shState->gpTexFBO(destRect.w, destRect.h);
-    GLMeta::blitBegin(gpTex);
-    GLMeta::blitSource(p->tex_gl);
-    GLMeta::blitRectangle(destRect, Vec2i());
-    GLMeta::blitEnd();
-    FloatRect bltSubRect((float) sourceRect.x / source.width(),
-                         (float) sourceRect.y / source.height(),
-                         ((float) source.width() / sourceRect.w) * ((float) destRect.w / gpTex.width),
-                         ((float) source.height() / sourceRect.h) * ((float) destRect.h / gpTex.height));
-    BltShader &shader = shState->shaders().blt;
-    shader.bind();
-    shader.setDestination(gpTex.tex);
-    shader.setSubRect(bltSubRect);
-    shader.setOpacity(normOpacity);
-    Quad &quad = shState->gpQuad();
-    quad.setTexPosRect(sourceRect, destRect);
-    quad.setColor(Vec4(1, 1, 1, normOpacity));
-    source.p->bindTexture(shader);
-    p->bindFBO();
-    p->pushSetViewport(shader);
-    p->blitQuad(quad);
-    p->popViewport();
+  bool blended = true;
+  if (source.p->inAtlas()) {
+    const IntRect &slot = source.p->atlas.rect;
+    IntRect src(sourceRect.x + slot.x, sourceRect.y + slot.y, sourceRect.w, sourceRect.h);
+    blended = p->stretchFrom(*source.p->atlas.page, destRect, src, opacity);
+  } else if (!source.isMega()) {
+    blended = p->stretchFrom(source.p->tex_gl, destRect, sourceRect, opacity);
+  } else {
+    // Each tile blits its share of the source rectangle
+    IntRect norm = normalizedRect(sourceRect);
+    for (size_t i = 0; i < source.p->megaTiles.size(); ++i) {
+      IntRect area = source.p->megaTileArea(i);
+      SDL_Rect part;
+      if (!SDL_IntersectRect(&norm, &area, &part))
+        continue;
+      // Neighbouring parts round their shared edge the same way
+      int x1 = destRect.x + (part.x - sourceRect.x) * destRect.w / sourceRect.w;
+      int y1 = destRect.y + (part.y - sourceRect.y) * destRect.h / sourceRect.h;
+      int x2 = destRect.x + (part.x + part.w - sourceRect.x) * destRect.w / sourceRect.w;
+      int y2 = destRect.y + (part.y + part.h - sourceRect.y) * destRect.h / sourceRect.h;
+      IntRect src(part.x - area.x, part.y - area.y, part.w, part.h);
+      // A flipped source maps its parts in reverse, flip each one back
+      if (sourceRect.w < 0) {
+        std::swap(x1, x2);
+        src.x += src.w;
+        src.w = -src.w;
+      }
+      if (sourceRect.h < 0) {
+        std::swap(y1, y2);
+        src.y += src.h;
+        src.h = -src.h;
+      }
+      if (!p->stretchFrom(source.p->megaTiles[i], IntRect(x1, y1, x2 - x1, y2 - y1),
+                          src, opacity))
+        blended = false;
+    }
   }
   p->addTaintedArea(destRect);
-  p->onModified();
+  /* Blending never lowers the destination alpha, copied
+   * pixels may well be translucent though */
+  p->onModified(destRect, blended);
 }
 
 void Bitmap::fillRect(int x, int y, int width, int height, const Vec4 &color)
@@ -601,12 +1093,15 @@ void Bitmap::fillRect(const IntRect &rect, const Vec4 &color)
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->fillRect(rect, color);
   if (color.w == 0) // Clear op
     p->substractTaintedArea(rect);
   else // Fill op
     p->addTaintedArea(rect);
-  p->onModified();
+  p->onModified(rect);
+  if (color.w >= 1.0f)
+    p->addSolidArea(rect);
 }
 
 void Bitmap::fill_rounded_rect(int x, int y, int width, int height, const Vec4 &color, float radius)
@@ -618,12 +1113,13 @@ void Bitmap::fill_rounded_rect(const IntRect &rect, const Vec4 &color, float rad
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->fill_rounded_rect(rect, color, radius);
   if (color.w == 0) // Clear op
     p->substractTaintedArea(rect);
   else // Fill op
     p->addTaintedArea(rect);
-  p->onModified();
+  p->onModified(rect);
 }
 
 void Bitmap::fill_circle(int x, int y, int width, int height,
@@ -636,12 +1132,13 @@ void Bitmap::fill_circle(const IntRect &rect, const Vec4 &color, float radius)
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->fill_circle(rect, color, radius);
   if (color.w == 0) // Clear op
     p->substractTaintedArea(rect);
   else // Fill op
     p->addTaintedArea(rect);
-  p->onModified();
+  p->onModified(rect);
 }
 
 void Bitmap::fill_triangle(int x, int y, int width, int height,
@@ -655,12 +1152,13 @@ void Bitmap::fill_triangle(const IntRect &rect, const Vec4 &color,
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->fill_triangle(rect, color, radius, angle);
   if (color.w == 0) // Clear op
     p->substractTaintedArea(rect);
   else // Fill op
     p->addTaintedArea(rect);
-  p->onModified();
+  p->onModified(rect);
 }
 
 void Bitmap::fill_polygon(int x, int y, int width, int height, const Vec4 &color,
@@ -674,12 +1172,59 @@ void Bitmap::fill_polygon(const IntRect &rect, const Vec4 &color,
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->fill_polygon(rect, color, radius, sides);
   if (color.w == 0) // Clear op
     p->substractTaintedArea(rect);
   else // Fill op
     p->addTaintedArea(rect);
-  p->onModified();
+  p->onModified(rect);
+}
+
+void Bitmap::drawShapes(const std::vector<Shape> &shapes)
+{
+  guardDisposed();
+  GUARD_MEGA;
+  if (shapes.empty())
+    return;
+  p->ensureOwnTexture();
+  ShapeQuadArray &quads = shState->shapeQuads();
+  quads.resize(shapes.size());
+  IntRect bounds;
+  size_t count = 0;
+  for (size_t i = 0; i < shapes.size(); i++) {
+    const Shape &s = shapes[i];
+    if (s.rect.w <= 0 || s.rect.h <= 0)
+      continue;
+    float maxRadius = std::min(s.rect.w, s.rect.h) * 0.5f;
+    Vec4 params(s.type, clamp<float>(s.radius, 0.0f, maxRadius),
+                s.angle, std::max(s.sides, 3));
+    float hw = s.rect.w * 0.5f, hh = s.rect.h * 0.5f;
+    ShapeVertex *vert = &quads.vertices[count * 4];
+    Quad::setTexPosRect(vert, FloatRect(-hw, -hh, s.rect.w, s.rect.h), s.rect);
+    Quad::setColor(vert, s.color);
+    for (int j = 0; j < 4; j++)
+      vert[j].shape = params;
+    p->addTaintedArea(s.rect);
+    if (count++ == 0)
+      bounds = s.rect;
+    else
+      SDL_UnionRect(&bounds, &s.rect, &bounds);
+  }
+  if (count == 0)
+    return;
+  quads.resize(count);
+  quads.commit();
+  ShapeShader &shader = shState->shaders().shape;
+  shader.bind();
+  shader.setTranslation(Vec2i());
+  p->bindFBO();
+  p->pushSetViewport(shader);
+  glState.blend.pushSet(true);
+  quads.draw();
+  glState.blend.pop();
+  p->popViewport();
+  p->onModified(bounds);
 }
 
 void Bitmap::gradientFillRect(int x, int y,
@@ -696,6 +1241,7 @@ void Bitmap::gradientFillRect(const IntRect &rect,
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   SimpleColorShader &shader = shState->shaders().simpleColor;
   shader.bind();
   shader.setTranslation(Vec2i());
@@ -717,7 +1263,9 @@ void Bitmap::gradientFillRect(const IntRect &rect,
   p->blitQuad(quad);
   p->popViewport();
   p->addTaintedArea(rect);
-  p->onModified();
+  p->onModified(rect);
+  if (color1.w >= 1.0f && color2.w >= 1.0f)
+    p->addSolidArea(rect);
 }
 
 void Bitmap::clearRect(int x, int y, int width, int height)
@@ -729,14 +1277,16 @@ void Bitmap::clearRect(const IntRect &rect)
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->fillRect(rect, Vec4());
-  p->onModified();
+  p->onModified(rect);
 }
 
 void Bitmap::blur()
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   Quad &quad = shState->gpQuad();
   FloatRect rect(0, 0, width(), height());
   quad.setTexPosRect(rect, rect);
@@ -764,64 +1314,79 @@ void Bitmap::blur()
   p->onModified();
 }
 
+/* Renders 'source' into all of 'target' through the bound
+ * Kawase pass, sampling 'offset' half texels away */
+static void kawasePass(KawaseShader::Pass &shader, TEXFBO &source,
+                       TEXFBO &target, float offset)
+{
+  TEX::bind(source.tex);
+  TEX::setSmooth(true);
+  shader.setTexSize(Vec2i(source.width, source.height));
+  shader.setHalfPixel(Vec2(offset * 0.5f / source.width, offset * 0.5f / source.height));
+  FBO::bind(target.fbo);
+  glState.viewport.pushSet(IntRect(0, 0, target.width, target.height));
+  shader.applyViewportProj();
+  Quad &quad = shState->gpQuad();
+  quad.setTexPosRect(FloatRect(0, 0, source.width, source.height),
+                     FloatRect(0, 0, target.width, target.height));
+  quad.draw();
+  glState.viewport.pop();
+  TEX::bind(source.tex);
+  TEX::setSmooth(false);
+}
+
+void Bitmap::blur(int radius)
+{
+  guardDisposed();
+  GUARD_MEGA;
+  if (radius <= 0)
+    return;
+  p->ensureOwnTexture();
+  /* Every level halves the size, the offset covers what's left
+   * so the strength grows smoothly with 'radius' */
+  int levels = 1;
+  while (levels < BLUR_MAX_LEVELS && (2 << levels) <= radius)
+    levels++;
+  float offset = clamp<float>((float) radius / (1 << levels), 0.5f, 4.0f);
+  TEXFBO chain[BLUR_MAX_LEVELS + 1];
+  chain[0] = p->tex_gl;
+  for (int i = 1; i <= levels; i++)
+    chain[i] = shState->texPool().request(std::max(width() >> i, 1),
+                                          std::max(height() >> i, 1));
+  KawaseShader &shader = shState->shaders().kawase;
+  glState.blend.pushSet(false);
+  shader.down.bind();
+  for (int i = 1; i <= levels; i++)
+    kawasePass(shader.down, chain[i - 1], chain[i], offset);
+  shader.up.bind();
+  for (int i = levels; i >= 1; i--)
+    kawasePass(shader.up, chain[i], chain[i - 1], offset);
+  glState.blend.pop();
+  for (int i = 1; i <= levels; i++)
+    shState->texPool().release(chain[i]);
+  p->onModified();
+}
+
 void Bitmap::radialBlur(int angle, int divisions)
 {
   guardDisposed();
   GUARD_MEGA;
   angle     = clamp<int>(angle, 0, 359);
   divisions = clamp<int>(divisions, 2, 100);
-  const int _width = width();
-  const int _height = height();
   float angleStep = (float) angle / (divisions-1);
-  float opacity   = 1.0f / divisions;
   float baseAngle = -((float) angle / 2);
-  ColorQuadArray qArray;
-  qArray.resize(5);
-  std::vector<Vertex> &vert = qArray.vertices;
-  int i = 0;
-  /* Center */
-  FloatRect texRect(0, 0, _width, _height);
-  FloatRect posRect(0, 0, _width, _height);
-  i += Quad::setTexPosRect(&vert[i*4], texRect, posRect);
-  /* Upper */
-  posRect = FloatRect(0, 0, _width, -_height);
-  i += Quad::setTexPosRect(&vert[i*4], texRect, posRect);
-  /* Lower */
-  posRect = FloatRect(0, _height*2, _width, -_height);
-  i += Quad::setTexPosRect(&vert[i*4], texRect, posRect);
-  /* Left */
-  posRect = FloatRect(0, 0, -_width, _height);
-  i += Quad::setTexPosRect(&vert[i*4], texRect, posRect);
-  /* Right */
-  posRect = FloatRect(_width*2, 0, -_width, _height);
-  i += Quad::setTexPosRect(&vert[i*4], texRect, posRect);
-  for (int i = 0; i < 4*5; ++i)
-    vert[i].color = Vec4(1, 1, 1, opacity);
-  qArray.commit();
-  TEXFBO newTex = shState->texPool().request(_width, _height);
-  FBO::bind(newTex.fbo);
-  glState.clearColor.pushSet(Vec4());
-  FBO::clear();
-  Transform trans;
-  trans.setOrigin(Vec2(_width / 2.0f, _height / 2.0f));
-  trans.setPosition(Vec2(_width / 2.0f, _height / 2.0f));
-  glState.blendMode.pushSet(BlendAddition);
-  SimpleMatrixShader &shader = shState->shaders().simpleMatrix;
+  // Smooth sampling is only turned on for our own texture
+  p->ensureOwnTexture();
+  RadialBlurShader &shader = shState->shaders().radialBlur;
   shader.bind();
-  p->bindTexture(shader);
+  shader.setSize(Vec2i(width(), height()));
+  shader.setAngles(baseAngle * PI / 180.0f, angleStep * PI / 180.0f);
+  shader.setSamples(divisions);
+  TEX::bind(p->tex_gl.tex);
   TEX::setSmooth(true);
-  p->pushSetViewport(shader);
-  for (int i = 0; i < divisions; ++i) {
-    trans.setRotation(baseAngle + i*angleStep);
-    shader.setMatrix(trans.getMatrix());
-    qArray.draw();
-  }
-  p->popViewport();
+  p->filterPass(shader);
+  TEX::bind(p->tex_gl.tex);
   TEX::setSmooth(false);
-  glState.blendMode.pop();
-  glState.clearColor.pop();
-  shState->texPool().release(p->tex_gl);
-  p->tex_gl = newTex;
   p->onModified();
 }
 
@@ -829,6 +1394,7 @@ void Bitmap::clear()
 {
   guardDisposed();
   GUARD_MEGA;
+  p->ensureOwnTexture();
   p->bindFBO();
   glState.clearColor.pushSet(Vec4());
   FBO::clear();
@@ -846,11 +1412,8 @@ static uint32_t &getPixelAt(SDL_Surface *surf, SDL_PixelFormat *form, int x, int
 
 void Bitmap::makeSurface() const
 {
-  p->allocSurface();
-  FBO::bind(p->tex_gl.fbo);
-  glState.viewport.pushSet(IntRect(0, 0, width(), height()));
-  gl.ReadPixels(0, 0, width(), height(), GL_RGBA, GL_UNSIGNED_BYTE, p->surface->pixels);
-  glState.viewport.pop();
+  p->ensureLoaded();
+  p->syncSurface(IntRect(0, 0, width(), height()));
 }
 
 bool Bitmap::is_alpha_pixel(int x, int y) const
@@ -858,10 +1421,7 @@ bool Bitmap::is_alpha_pixel(int x, int y) const
   guardDisposed();
   GUARD_MEGA;
   if (x < 0 || y < 0 || x >= width() || y >= height()) return false;
-  if (!p->surface) makeSurface();
-  uint32_t pixel = getPixelAt(p->surface, p->format, x, y);
-  uint8_t alpha = (pixel >> p->format->Ashift) & 0xFF;
-  return alpha == 0;
+  return !p->isOpaqueAt(x, y);
 }
 
 Color Bitmap::getPixel(int x, int y) const
@@ -870,7 +1430,7 @@ Color Bitmap::getPixel(int x, int y) const
   GUARD_MEGA;
   if (x < 0 || y < 0 || x >= width() || y >= height())
     return Vec4();
-  if (!p->surface) makeSurface();
+  p->syncSurfaceAt(x, y);
   uint32_t pixel = getPixelAt(p->surface, p->format, x, y);
   return Color((pixel >> p->format->Rshift) & 0xFF,
                (pixel >> p->format->Gshift) & 0xFF,
@@ -889,6 +1449,7 @@ void Bitmap::setPixel(int x, int y, const Color &color)
     (uint8_t) clamp<double>(color.blue,  0, 255),
     (uint8_t) clamp<double>(color.alpha, 0, 255)
   };
+  p->ensureOwnTexture();
   TEX::bind(p->tex_gl.tex);
   TEX::uploadSubImage(x, y, 1, 1, &pixel, GL_RGBA);
   p->addTaintedArea(IntRect(x, y, 1, 1));
@@ -898,6 +1459,8 @@ void Bitmap::setPixel(int x, int y, const Color &color)
     uint32_t &surfPixel = getPixelAt(p->surface, p->format, x, y);
     surfPixel = SDL_MapRGBA(p->format, pixel[0], pixel[1], pixel[2], pixel[3]);
   }
+  if (p->hitMaskValid && x >= 0 && y >= 0 && x < width() && y < height())
+    p->setOpaqueAt(x, y, pixel[3] != 0);
   p->onModified(false);
 }
 
@@ -906,9 +1469,22 @@ bool Bitmap::getRaw(void *output, int output_size)
   if (output_size != width()*height()*4)
     return false;
   guardDisposed();
-  if (p->surface || p->megaSurface) {
-    void *src = (p->megaSurface) ? p->megaSurface->pixels : p->surface->pixels;
-    memcpy(output, src, output_size);
+  if (isMega()) {
+    // Read each tile back, then spread its rows over the output
+    int pitch = width() * 4;
+    std::vector<uint8_t> rows;
+    for (size_t i = 0; i < p->megaTiles.size(); ++i) {
+      IntRect area = p->megaTileArea(i);
+      rows.resize(area.w * area.h * 4);
+      FBO::bind(p->megaTiles[i].fbo);
+      gl.ReadPixels(0, 0, area.w, area.h, GL_RGBA, GL_UNSIGNED_BYTE, &rows[0]);
+      uint8_t *dst = (uint8_t*) output + area.y * pitch + area.x * 4;
+      for (int y = 0; y < area.h; ++y)
+        memcpy(dst + y * pitch, &rows[y * area.w * 4], area.w * 4);
+    }
+  } else if (p->surface) {
+    makeSurface();
+    memcpy(output, p->surface->pixels, output_size);
   } else {
     FBO::bind(getGLTypes().fbo);
     gl.ReadPixels(0,0,width(),height(),GL_RGBA,GL_UNSIGNED_BYTE,output);
@@ -925,8 +1501,10 @@ void Bitmap::replaceRaw(void *pixel_data, int size)
   int requiredsize = w*h*4;
   if (size != w*h*4)
     throw Exception(Exception::HiddenChestError, "Replacement bitmap data is not large enough (given %i bytes, need %i)", size, requiredsize);
+  p->ensureOwnTexture();
+  // The storage already has the right size, don't reallocate it every call
   TEX::bind(getGLTypes().tex);
-  TEX::uploadImage(w, h, pixel_data, GL_RGBA);
+  GLMeta::streamSubImage(0, 0, w, h, pixel_data, GL_RGBA);
   taintArea(IntRect(0,0,w,h));
   p->onModified();
 }
@@ -935,8 +1513,8 @@ void Bitmap::invert_colors()
 {
   guardDisposed();
   GUARD_MEGA;
-  if (!p->surface)
-    makeSurface();
+  makeSurface();
+  p->ensureOwnTexture();
   SDL_PixelFormat *fmt = p->format;
   int w = p->tex_gl.width, h = p->tex_gl.height;
   uint8_t invert[w * 4];
@@ -971,67 +1549,33 @@ void Bitmap::hueChange(int hue)
   GUARD_MEGA;
   if ((hue % 360) == 0)
     return;
-  TEXFBO newTex = shState->texPool().request(width(), height());
-  FloatRect texRect(rect());
-  Quad &quad = shState->gpQuad();
-  quad.setTexPosRect(texRect, texRect);
-  quad.setColor(Vec4(1, 1, 1, 1));
   HueShader &shader = shState->shaders().hue;
   shader.bind();
   // Shader expects normalized value
   shader.setHueAdjust(wrapRange(hue, 0, 359) / 360.0f);
-  FBO::bind(newTex.fbo);
-  p->pushSetViewport(shader);
-  p->bindTexture(shader);
-  p->blitQuad(quad);
-  p->popViewport();
-  TEX::unbind();
-  shState->texPool().release(p->tex_gl);
-  p->tex_gl = newTex;
+  p->filterPass(shader);
   p->onModified();
 }
 
 void Bitmap::gray_out()
 {
   guardDisposed();
-  TEXFBO newTex = shState->texPool().request(width(), height());
-  FloatRect texRect(rect());
-  Quad &quad = shState->gpQuad();
-  quad.setTexPosRect(texRect, texRect);
-  quad.setColor(Vec4(1, 1, 1, 1));
+  GUARD_MEGA;
   GrayShader &shader = shState->shaders().gray;
   shader.bind();
   shader.setGray(1.0);
-  FBO::bind(newTex.fbo);
-  p->pushSetViewport(shader);
-  p->bindTexture(shader);
-  p->blitQuad(quad);
-  p->popViewport();
-  TEX::unbind();
-  shState->texPool().release(p->tex_gl);
-  p->tex_gl = newTex;
+  p->filterPass(shader);
   p->onModified();
 }
 
 void Bitmap::grayscale(bool invert)
 {
   guardDisposed();
-  TEXFBO newTex = shState->texPool().request(width(), height());
-  FloatRect texRect(rect());
-  Quad &quad = shState->gpQuad();
-  quad.setTexPosRect(texRect, texRect);
-  quad.setColor(Vec4(1, 1, 1, 1));
+  GUARD_MEGA;
   GrayScaleShader &shader = shState->shaders().grayscale;
   shader.bind();
   shader.set_factor(invert ? 1.0 : 0.0);
-  FBO::bind(newTex.fbo);
-  p->pushSetViewport(shader);
-  p->bindTexture(shader);
-  p->blitQuad(quad);
-  p->popViewport();
-  TEX::unbind();
-  shState->texPool().release(p->tex_gl);
-  p->tex_gl = newTex;
+  p->filterPass(shader);
   p->onModified();
 }
 
@@ -1041,6 +1585,11 @@ void Bitmap::alpha_mask(const Bitmap &source)
   GUARD_MEGA;
   if (source.isDisposed())
     return;
+  source.ensureNonMega();
+  p->ensureOwnTexture();
+  // The mask gets sampled as a texture of its own
+  source.p->ensureLoaded();
+  source.p->leaveAtlas();
   FloatRect tex_rect(rect());
   Quad &quad = shState->gpQuad();
   quad.setTexPosRect(tex_rect, tex_rect);
@@ -1067,67 +1616,64 @@ void Bitmap::color_mask(int rng, int r, int g, int b)
   float red = clamp<int>(r, 0, 255) / 255.0f;
   float green = clamp<int>(g, 0, 255) / 255.0f;
   float blue = clamp<int>(b, 0, 255) / 255.0f;
-  FloatRect tex_rect(rect());
-  Quad &quad = shState->gpQuad();
-  quad.setTexPosRect(tex_rect, tex_rect);
-  quad.setColor(Vec4(1, 1, 1, 1));
   ColorMaskShader &shader = shState->shaders().color_mask;
   shader.bind();
   shader.set_source();
   shader.set_range(range);
   shader.set_color(red, green, blue);
-  p->pushSetViewport(shader);
-  p->bindTexture(shader);
-  p->blitQuad(quad);
-  p->popViewport();
-  TEX::unbind();
+  p->filterPass(shader);
   p->addTaintedArea(rect());
   p->onModified();
-  return;
 }
 
 void Bitmap::thermal()
 {
   guardDisposed();
   GUARD_MEGA;
-  FloatRect tex_rect(rect());
-  Quad &quad = shState->gpQuad();
-  quad.setTexPosRect(tex_rect, tex_rect);
-  quad.setColor(Vec4(1, 1, 1, 1));
   ThermalShader &shader = shState->shaders().thermal;
   shader.bind();
-  p->pushSetViewport(shader);
-  p->bindTexture(shader);
-  p->blitQuad(quad);
-  p->popViewport();
-  TEX::unbind();
+  p->filterPass(shader);
   p->addTaintedArea(rect());
   p->onModified();
-  return;
 }
 
 void Bitmap::apply_this_shader(ShaderBase &shader, bool enable=false, Vec4 vec=Vec4())
 {
-  TEXFBO text = shState->texPool().request(p->tex_gl.width, p->tex_gl.height);
-  Quad &quad = shState->gpQuad();
-  FloatRect r(IntRect(0, 0, p->tex_gl.width, p->tex_gl.height));
-  quad.setTexPosRect(r, r);
-  enable ? quad.setColor(vec) : quad.setColor(Vec4(1, 1, 1, 1));
   shader.bind();
-  FBO::bind(text.fbo);
-  p->pushSetViewport(shader);
-  p->bindTexture(shader);
-  p->blitQuad(quad);
-  p->popViewport();
-  TEX::unbind();
-  shState->texPool().release(p->tex_gl);
-  p->tex_gl = text;
+  p->filterPass(shader, enable ? vec : Vec4(1, 1, 1, 1));
+  p->onModified();
+}
+
+void Bitmap::applyFilters(const std::vector<Filter> &filters)
+{
+  guardDisposed();
+  GUARD_MEGA;
+  if (filters.empty())
+    return;
+  FilterChainShader &shader = shState->shaders().filter_chain;
+  float ops[FILTER_CHAIN_MAX];
+  Vec4 params[FILTER_CHAIN_MAX];
+  for (size_t i = 0; i < filters.size(); i += FILTER_CHAIN_MAX) {
+    int count = std::min<size_t>(filters.size() - i, FILTER_CHAIN_MAX);
+    for (int j = 0; j < count; j++) {
+      const Filter &f = filters[i + j];
+      ops[j] = f.type;
+      params[j] = f.param;
+      if (f.type == Filter::Hue)
+        params[j].x = wrapRange((int) f.param.x, 0, 359) / 360.0f;
+    }
+    shader.bind();
+    shader.setOps(ops, params, count);
+    p->filterPass(shader);
+  }
+  p->addTaintedArea(rect());
   p->onModified();
 }
 
 void Bitmap::turn_sepia()
 {
   guardDisposed();
+  GUARD_MEGA;
   SepiaShader &shader = shState->shaders().sepia;
   apply_this_shader(shader);
 }
@@ -1169,6 +1715,7 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
     return;
   if (str[0] == ' ' && str[1] == '\0')
     return;
+  p->ensureOwnTexture();
   bool is_solid = shState->rtData().config.solidFonts;
   Font *f = p->font;
   TTF_Font *font = f->getSdlFont();
@@ -1286,9 +1833,9 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
         }
         TEX::bind(p->tex_gl.tex);
         if (!subImage) {
-          TEX::uploadSubImage(posRect.x, posRect.y,
-                              posRect.w, posRect.h,
-                              surf->pixels, GL_RGBA);
+          GLMeta::streamSubImage(posRect.x, posRect.y,
+                                 posRect.w, posRect.h,
+                                 surf->pixels, GL_RGBA);
         } else {
           GLMeta::subRectImageUpload(surf->w, subSrcX, subSrcY,
                                      posRect.x, posRect.y,
@@ -1300,7 +1847,7 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
     } else {// Squeezing involved: need to use intermediary TexFBO
       TEXFBO &gpTF = shState->gpTexFBO(surf->w, surf->h);
       TEX::bind(gpTF.tex);
-      TEX::uploadSubImage(0, 0, surf->w, surf->h, surf->pixels, GL_RGBA);
+      GLMeta::streamSubImage(0, 0, surf->w, surf->h, surf->pixels, GL_RGBA);
       GLMeta::blitBegin(p->tex_gl);
       GLMeta::blitSource(gpTF);
       GLMeta::blitRectangle(IntRect(0, 0, surf->w, surf->h), posRect, true);
@@ -1324,7 +1871,7 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
     shader.setSubRect(bltRect);
     shader.setOpacity(txtAlpha);
     shState->bindTex();
-    TEX::uploadSubImage(0, 0, surf->w, surf->h, surf->pixels, GL_RGBA);
+    GLMeta::streamSubImage(0, 0, surf->w, surf->h, surf->pixels, GL_RGBA);
     TEX::setSmooth(true);
     Quad &quad = shState->gpQuad();
     quad.setTexRect(FloatRect(0, 0, surf->w, surf->h));
@@ -1336,7 +1883,7 @@ void Bitmap::drawText(const IntRect &rect, const char *str, int align)
   }
   SDL_FreeSurface(surf);
   p->addTaintedArea(posRect);
-  p->onModified();
+  p->onModified(posRect);
 }
 /* http://www.lemoda.net/c/utf8-to-ucs2/index.html */
 static uint16_t utf8_to_ucs2(const char *_input, const char **end_ptr)
@@ -1439,18 +1986,102 @@ void Bitmap::setInitFont(Font *value)
 
 TEXFBO &Bitmap::getGLTypes()
 {
+  p->ensureLoaded();
+  p->leaveAtlas();
   return p->tex_gl;
 }
 
-SDL_Surface *Bitmap::megaSurface() const
+bool Bitmap::moveToAtlas()
+{
+  guardDisposed();
+  p->ensureLoaded();
+  if (p->inAtlas())
+    return true;
+  if (!p->megaTiles.empty())
+    return false;
+  AtlasSlot slot;
+  if (!shState->texPool().atlasAlloc(p->tex_gl.width, p->tex_gl.height, slot))
+    return false;
+  /* Copies shifted by one pixel each way repeat the edges into the
+   * gutter, so filtering past the border acts like clamping to the
+   * edge. Corners go first, then the sides, the image itself last */
+  static const int shifts[9][2] =
+  { {-1,-1}, {1,-1}, {-1,1}, {1,1}, {0,-1}, {0,1}, {-1,0}, {1,0}, {0,0} };
+  GLMeta::blitBegin(*slot.page);
+  GLMeta::blitSource(p->tex_gl);
+  for (int i = 0; i < 9; ++i) {
+    Vec2i pos(slot.rect.x + shifts[i][0] * ATLAS_GUTTER,
+              slot.rect.y + shifts[i][1] * ATLAS_GUTTER);
+    GLMeta::blitRectangle(rect(), pos);
+  }
+  GLMeta::blitEnd();
+  p->releaseTexture();
+  // Only the size is kept, see BitmapPrivate::atlas
+  TEXFBO sized;
+  sized.width = slot.rect.w;
+  sized.height = slot.rect.h;
+  p->tex_gl = sized;
+  p->atlas = slot;
+  return true;
+}
+
+bool Bitmap::isInAtlas() const
+{
+  guardDisposed();
+  return p->inAtlas();
+}
+
+const TEXFBO *Bitmap::atlasPage(IntRect &rect) const
+{
+  if (!p->inAtlas())
+    return 0;
+  rect = p->atlas.rect;
+  return p->atlas.page;
+}
+
+bool Bitmap::isMega() const
+{
+  p->ensureLoaded();
+  return !p->megaTiles.empty();
+}
+
+const TEXFBO *Bitmap::megaTile(int index, IntRect &area) const
 {
-  return p->megaSurface;
+  p->ensureLoaded();
+  if (index < 0 || index >= (int) p->megaTiles.size())
+    return 0;
+  area = p->megaTileArea(index);
+  return &p->megaTiles[index];
+}
+
+void Bitmap::blitRegion(const IntRect &rect, const Vec2i &dstPos) const
+{
+  p->ensureLoaded();
+  if (p->inAtlas()) {
+    const IntRect &slot = p->atlas.rect;
+    GLMeta::blitSource(*p->atlas.page);
+    GLMeta::blitRectangle(IntRect(rect.x + slot.x, rect.y + slot.y, rect.w, rect.h), dstPos);
+    return;
+  }
+  if (p->megaTiles.empty()) {
+    GLMeta::blitSource(p->tex_gl);
+    GLMeta::blitRectangle(rect, dstPos);
+    return;
+  }
+  for (size_t i = 0; i < p->megaTiles.size(); ++i) {
+    IntRect area = p->megaTileArea(i);
+    SDL_Rect part;
+    if (!SDL_IntersectRect(&rect, &area, &part))
+      continue;
+    GLMeta::blitSource(p->megaTiles[i]);
+    GLMeta::blitRectangle(IntRect(part.x - area.x, part.y - area.y, part.w, part.h),
+                          Vec2i(dstPos.x + part.x - rect.x, dstPos.y + part.y - rect.y));
+  }
 }
 
 SDL_Surface *Bitmap::surface() const
 {
-  if (!p->surface)
-    makeSurface();
+  makeSurface();
   return p->surface;
 }
 
@@ -1463,6 +2094,8 @@ void Bitmap::ensureNonMega() const
 
 void Bitmap::bindTex(ShaderBase &shader)
 {
+  p->ensureLoaded();
+  p->leaveAtlas();
   p->bindTexture(shader);
 }
 
@@ -1479,28 +2112,33 @@ bool Bitmap::write(const char *fn, const char *ext) const
 {
   char str[200];
   sprintf(str, "%s.%s", fn, ext);
-  SDL_LockSurface(surface());
+  // The surface stays cached in BitmapPrivate, so it's not freed here
+  SDL_Surface *surf = surface();
+  SDL_LockSurface(surf);
   bool failed = false;
   if (!strcmp(ext, "jpg")) {
-    if ( IMG_SaveJPG(surface(), str, 95) != 0 ) {
-      Debug() << "Freeing JPG surface after failure";
+    if ( IMG_SaveJPG(surf, str, 95) != 0 ) {
+      Debug() << "Failed to save JPG surface";
       failed = true;
     }
   } else {
-    if ( IMG_SavePNG(surface(), str) != 0 ) {
-      Debug() << "Freeing PNG surface after failure";
+    if ( IMG_SavePNG(surf, str) != 0 ) {
+      Debug() << "Failed to save PNG surface";
       failed = true;
     }
   }
-  SDL_FreeSurface(surface());
+  SDL_UnlockSurface(surf);
   return !failed;
 }
 
 void Bitmap::releaseResources()
 {
-  if (p->megaSurface)
-    SDL_FreeSurface(p->megaSurface);
-  else
-    shState->texPool().release(p->tex_gl);
+  Scene::markChanged();
+  if (!p->megaTiles.empty())
+    p->releaseMega();
+  else if (p->inAtlas())
+    shState->texPool().atlasFree(p->atlas);
+  else if (!p->pending) // Otherwise ~BitmapPrivate cancels the decode
+    p->releaseTexture();
   delete p;
 }
\ No newline at end of file
@@ -26,11 +26,14 @@
 #include "etc-internal.h"
 #include "etc.h"
 #include <sigc++/signal.h>
+#include <vector>
 
 class Font;
 class ShaderBase;
 struct TEXFBO;
 struct SDL_Surface;
+struct ImageCacheEntry;
+struct ImageLoadJob;
 
 struct BitmapPrivate;
 // FIXME make this class use proper RGSS classes again
@@ -44,6 +47,15 @@ public:
   // Clone constructor
   Bitmap(const Bitmap &other);
   ~Bitmap();
+  /* Loads through the image cache, sharing the texture of
+   * other Bitmaps with the same file and hue until written to */
+  static Bitmap *cached(const char *filename, int hue = 0);
+  /* Returns at once while the file gets decoded in the background.
+   * The texture is uploaded at the next prepareDraw after decoding
+   * finished; using the Bitmap before that waits for this file */
+  static Bitmap *loadAsync(const char *filename);
+  // True once using the Bitmap won't have to wait for its file anymore
+  bool isLoaded() const;
   int width()  const;
   int height() const;
   IntRect rect() const;
@@ -69,6 +81,26 @@ public:
                          const Vec4 &color, float radius);
   void fill_rounded_rect(const IntRect &rect,
                          const Vec4 &color, float radius);
+  // One entry of drawShapes(), drawn like the fill_* call of its type
+  struct Shape
+  {
+    // Keep in sync with shape.frag
+    enum Type
+    {
+      RoundedRect = 0,
+      Circle = 1,
+      Triangle = 2,
+      Polygon = 3
+    };
+    Type type;
+    IntRect rect;
+    Vec4 color;
+    float radius, angle;
+    int sides;
+  };
+  /* Draws all 'shapes' in order with a single draw call. Unlike
+   * fill_triangle, triangles are blended with what's below them */
+  void drawShapes(const std::vector<Shape> &shapes);
   void gradientFillRect(int x, int y, int width, int height,
                         const Vec4 &color1, const Vec4 &color2,
                         bool vertical = false);
@@ -78,6 +110,9 @@ public:
   void clearRect(int x, int y, int width, int height);
   void clearRect(const IntRect &rect);
   void blur();
+  /* Dual Kawase blur, the cost hardly grows with 'radius'
+   * since the bitmap gets downsampled instead */
+  void blur(int radius);
   void radialBlur(int angle, int divisions);
   void clear();
   void makeSurface() const;
@@ -95,6 +130,27 @@ public:
   void alpha_mask(const Bitmap &source);
   void color_mask(int rng, int r, int g, int b);
   void thermal();
+  // One step of applyFilters(), what 'param' holds depends on the type
+  struct Filter
+  {
+    // Keep in sync with filter_chain.frag
+    enum Type
+    {
+      Gray = 0,      // x: amount, 0 to 1
+      Sepia = 1,
+      Hue = 2,       // x: shift in degrees
+      Thermal = 3,
+      Invert = 4,
+      GrayScale = 5, // x: 1 to invert
+      ColorMask = 6  // xyz: color, w: range, 0 to 1
+    };
+    Type type;
+    Vec4 param;
+    Filter(Type type, const Vec4 &param = Vec4()) : type(type), param(param) {}
+  };
+  /* Runs all 'filters' in order as a single shader pass
+   * (or one per FILTER_CHAIN_MAX filters) */
+  void applyFilters(const std::vector<Filter> &filters);
   enum TextAlign
   {
     Left = 0,
@@ -112,7 +168,20 @@ public:
   void setInitFont(Font *value);
   // <internal>
   TEXFBO &getGLTypes();
-  SDL_Surface *megaSurface() const;
+  bool isMega() const;
+  /* Texture of mega surface tile 'index' and the area of the
+   * Bitmap it covers, 0 past the last tile */
+  const TEXFBO *megaTile(int index, IntRect &area) const;
+  /* Copies 'rect' of this Bitmap to 'dstPos' of the current
+   * GLMeta::blitBegin() target, mega surface or not */
+  void blitRegion(const IntRect &rect, const Vec2i &dstPos) const;
+  /* Moves the texture into a shared atlas page, false if it's
+   * too big or the atlas is full. It moves back out on its own
+   * as soon as it's modified or its texture is bound directly */
+  bool moveToAtlas();
+  bool isInAtlas() const;
+  // The atlas page and the area in it, 0 if not in the atlas
+  const TEXFBO *atlasPage(IntRect &rect) const;
   SDL_Surface *surface() const;
   void ensureNonMega() const;
   // Binds the backing texture and sets the correct texture size uniform in shader
@@ -123,6 +192,8 @@ public:
   sigc::signal<void> modified;
 
 private:
+  Bitmap(ImageCacheEntry *entry);
+  Bitmap(ImageLoadJob *job);
   SDL_Surface* render_str(bool is_solid, const char *str, SDL_Color c);
   void apply_this_shader(ShaderBase &shader, bool enable, Vec4 vec);
   void releaseResources();
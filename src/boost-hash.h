@@ -78,6 +78,18 @@ public:
 		return iter->second;
 	}
 
+	/* Returns 0 if 'key' is not present. Unlike operator[]
+	 * this never inserts, so it's safe to use concurrently */
+	inline const V *find(const K &key) const
+	{
+		const_iterator iter = p.find(key);
+
+		if (iter == p.cend())
+			return 0;
+
+		return &iter->second;
+	}
+
 	inline V &operator[](const K &key)
 	{
 		return p[key];
@@ -24,6 +24,8 @@
 #include "resolution.h"
 #include <SDL_filesystem.h>
 #include <fstream>
+#include <algorithm>
+#include <stdlib.h>
 #include <stdint.h>
 #include "debugwriter.h"
 #include "util.h"
@@ -162,6 +164,12 @@ Config::Config()
   customScript = "";
   pathCache = true;
   font_cache = false;
+  imageCacheSize = 64;
+  shaderCache = true;
+  headless = false;
+  benchmark = false;
+  benchmarkFrames = 0;
+  benchmarkReport = "benchmark.json";
   useScriptNames = false;
 }
 
@@ -185,6 +193,21 @@ void Config::read(int argc, char *argv[])
       argv++;
     }
   }
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--benchmark") {
+      benchmark = true;
+    } else if (arg.compare(0, 12, "--benchmark=") == 0) {
+      benchmark = true;
+      benchmarkFrames = std::max(atoi(arg.c_str() + 12), 0);
+    } else if (arg.compare(0, 19, "--benchmark-report=") == 0) {
+      benchmarkReport = arg.substr(19);
+    } else if (arg.compare(0, 19, "--image-cache-size=") == 0) {
+      imageCacheSize = std::max(atoi(arg.c_str() + 19), 0);
+    }
+  }
   rgssVersion = clamp(rgssVersion, 0, 4);
   SE.sourceCount = clamp(SE.sourceCount, 6, 64);
   //if (!dataPathOrg.empty() && !dataPathApp.empty())
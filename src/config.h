@@ -52,6 +52,20 @@ struct Config
   bool allowSymlinks;
   bool pathCache;
   bool font_cache;
+  /* Texture budget of the image cache in MB, set with
+   * --image-cache-size=N, 0 keeps nothing unreferenced */
+  int imageCacheSize;
+  // Keep linked shader programs in the SDL pref folder
+  bool shaderCache;
+  /* No window, display or sound card needed, see --headless.
+   * Everything renders offscreen and audio is discarded */
+  bool headless;
+  /* Fixed timestep run that writes frame statistics to
+   * 'benchmarkReport', see --benchmark. 'benchmarkFrames'
+   * of 0 runs until the script calls Graphics.finish_benchmark */
+  bool benchmark;
+  int benchmarkFrames;
+  std::string benchmarkReport;
   std::string dataPathOrg;
   std::string dataPathApp;
   std::string iconPath;
@@ -22,6 +22,7 @@
 #include "etc.h"
 #include "serial-util.h"
 #include "exception.h"
+#include "scene.h"
 #include <SDL_types.h>
 #include <SDL_pixels.h>
 
@@ -56,6 +57,7 @@ const Color &Color::operator=(const Color &o)
   blue  = o.blue;
   alpha = o.alpha;
   norm  = o.norm;
+  Scene::markChanged();
   return o;
 }
 
@@ -66,30 +68,35 @@ void Color::set(double red, double green, double blue, double alpha)
   this->blue  = blue;
   this->alpha = alpha;
   updateInternal();
+  Scene::markChanged();
 }
 
 void Color::setRed(double value)
 {
   red = value;
   norm.x = clamp<double>(value, 0, 255) / 255;
+  Scene::markChanged();
 }
 
 void Color::setGreen(double value)
 {
   green = value;
   norm.y = clamp<double>(value, 0, 255) / 255;
+  Scene::markChanged();
 }
 
 void Color::setBlue(double value)
 {
   blue = value;
   norm.z = clamp<double>(value, 0, 255) / 255;
+  Scene::markChanged();
 }
 
 void Color::setAlpha(double value)
 {
   alpha = value;
   norm.w = clamp<double>(value, 0, 255) / 255;
+  Scene::markChanged();
 }
 // Serializable
 int Color::serialSize() const
@@ -168,6 +175,7 @@ void Tone::set(double red, double green, double blue, double gray)
   this->blue  = blue;
   this->gray  = gray;
   updateInternal();
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -178,6 +186,7 @@ const Tone& Tone::operator=(const Tone &o)
   blue  = o.blue;
   gray  = o.gray;
   norm  = o.norm;
+  Scene::markChanged();
   valueChanged();
   return o;
 }
@@ -186,6 +195,7 @@ void Tone::setRed(double value)
 {
   red = value;
   norm.x = (float) clamp<double>(value, -255, 255) / 255;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -193,6 +203,7 @@ void Tone::setGreen(double value)
 {
   green = value;
   norm.y = (float) clamp<double>(value, -255, 255) / 255;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -200,6 +211,7 @@ void Tone::setBlue(double value)
 {
   blue = value;
   norm.z = (float) clamp<double>(value, -255, 255) / 255;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -207,6 +219,7 @@ void Tone::setGray(double value)
 {
   gray = value;
   norm.w = (float) clamp<double>(value, 0, 255) / 255;
+  Scene::markChanged();
   valueChanged();
 }
 // Serializable
@@ -286,6 +299,7 @@ void Rect::set(int x, int y, int w, int h)
   this->y = y;
   width = w;
   height = h;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -295,6 +309,7 @@ const Rect &Rect::operator=(const Rect &o)
   y      = o.y;
   width  = o.width;
   height = o.height;
+  Scene::markChanged();
   valueChanged();
   return o;
 }
@@ -303,6 +318,7 @@ void Rect::empty()
 {
   if (!(x || y || width || height)) return;
   x = y = width = height = 0;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -315,6 +331,7 @@ void Rect::setX(int value)
 {
   if (x == value) return;
   x = value;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -322,6 +339,7 @@ void Rect::setY(int value)
 {
   if (y == value) return;
   y = value;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -329,6 +347,7 @@ void Rect::setWidth(int value)
 {
   if (width == value) return;
   width = value;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -336,6 +355,7 @@ void Rect::setHeight(int value)
 {
   if (height == value) return;
   height = value;
+  Scene::markChanged();
   valueChanged();
 }
 
@@ -383,8 +383,12 @@ void EventThread::process(RGSSThreadData &rtData)
         SDL_SetWindowSize(win, event.window.data1, event.window.data2);
         break;
       case REQUEST_MESSAGEBOX :
-        SDL_ShowSimpleMessageBox(event.user.code, rtData.config.windowTitle.c_str(),
-                                 (const char*) event.user.data1, win);
+        // Nobody could click it away without a display
+        if (rtData.config.headless)
+          Debug() << (const char*) event.user.data1;
+        else
+          SDL_ShowSimpleMessageBox(event.user.code, rtData.config.windowTitle.c_str(),
+                                   (const char*) event.user.data1, win);
         free(event.user.data1);
         msgBoxDone.set();
         break;
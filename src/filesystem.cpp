@@ -277,6 +277,9 @@ struct FileSystemPrivate
   /* This is for compatibility with games that take Windows'
    * case insensitivity for granted */
   bool havePathCache;
+
+  // Calls 'callback' for every file in 'dir', cached or not
+  void enumerate(const char *dir, PHYSFS_EnumerateCallback callback, void *data);
 };
 
 FileSystem::FileSystem(const char *argv0, bool allowSymlinks)
@@ -501,8 +504,11 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename)
   if (last != '.' && last != '\0')
     return PHYSFS_ENUM_STOP;
   // If the path cache is active, translate from lower case to mixed case path
-  if (data.pathTrans)
-    fullPath = (*data.pathTrans)[fullPath].c_str();
+  if (data.pathTrans) {
+    const std::string *mixed = data.pathTrans->find(fullPath);
+    if (mixed)
+      fullPath = mixed->c_str();
+  }
   PHYSFS_File *phys = PHYSFS_openRead(fullPath);
   if (!phys) {
   /* Failing to open this file here means there must be a deeper rooted problem
@@ -519,43 +525,104 @@ openReadEnumCB(void *d, const char *dirpath, const char *filename)
   return PHYSFS_ENUM_OK;
 }
 
-void FileSystem::openRead(OpenHandler &handler, const char *filename)
+/* Splits 'filename' into 'buffer', returns the length of
+ * the file name part that 'file' points to */
+static size_t splitPath(char *buffer, size_t size, const char *filename,
+                        bool lowerCase, const char *&dir, const char *&file)
 {
-  char buffer[512];
-  size_t len = strcpySafe(buffer, filename, sizeof(buffer), -1);
+  size_t len = strcpySafe(buffer, filename, size, -1);
   char *delim;
-  if (p->havePathCache)
+  if (lowerCase)
     for (size_t i = 0; i < len; ++i)
       buffer[i] = tolower(buffer[i]);
 // Find the deliminator separating directory and file name
   for (delim = buffer + len; delim > buffer; --delim)
     if (*delim == '/') break;
   const bool root = (delim == buffer);
-  const char *file = buffer;
-  const char *dir = "";
+  file = buffer;
+  dir = "";
   if (!root) {
   // Cut the buffer in half so we can use it for both filename and directory path
     *delim = '\0';
     file = delim+1;
     dir = buffer;
   }
-  OpenReadEnumData data(handler, file, len + buffer - delim - !root,
-    p->havePathCache ? &p->pathCache : 0);
-  if (p->havePathCache) {
+  return len + buffer - delim - !root;
+}
+
+void FileSystemPrivate::enumerate(const char *dir,
+                                  PHYSFS_EnumerateCallback callback, void *data)
+{
+  if (havePathCache) {
     /* Get the list of files contained in this directory
-     * and manually iterate over them */
-    const std::vector<std::string> &fileList = p->fileLists[dir];
-    for (size_t i = 0; i < fileList.size(); ++i)
-      openReadEnumCB(&data, dir, fileList[i].c_str());
+     * and manually iterate over them. Only lookups happen here
+     * so the image loader threads may search at the same time */
+    const std::vector<std::string> *fileList = fileLists.find(dir);
+    for (size_t i = 0; fileList && i < fileList->size(); ++i)
+      callback(data, dir, (*fileList)[i].c_str());
   } else {
-    PHYSFS_enumerate(dir, openReadEnumCB, &data);
+    PHYSFS_enumerate(dir, callback, data);
   }
+}
+
+void FileSystem::openRead(OpenHandler &handler, const char *filename)
+{
+  char buffer[512];
+  const char *dir, *file;
+  size_t fileN = splitPath(buffer, sizeof(buffer), filename,
+                           p->havePathCache, dir, file);
+  OpenReadEnumData data(handler, file, fileN,
+    p->havePathCache ? &p->pathCache : 0);
+  p->enumerate(dir, openReadEnumCB, &data);
   if (data.physfsError)
     throw Exception(Exception::PHYSFSError, "PhysFS: %s", data.physfsError);
   if (data.matchCount == 0)
     throw Exception(Exception::NoFileError, "%s", filename);
 }
 
+struct FindPathEnumData
+{
+  const char *filename;
+  size_t filenameN;
+  BoostHash<std::string, std::string> *pathTrans;
+  std::string found;
+};
+
+// Same matching as openReadEnumCB, minus the opening
+static PHYSFS_EnumerateCallbackResult
+findPathEnumCB(void *d, const char *dirpath, const char *filename)
+{
+  FindPathEnumData &data = *static_cast<FindPathEnumData*>(d);
+  if (!data.found.empty())
+    return PHYSFS_ENUM_STOP;
+  if (strncmp(filename, data.filename, data.filenameN) != 0)
+    return PHYSFS_ENUM_OK;
+  char last = filename[data.filenameN];
+  if (last != '.' && last != '\0')
+    return PHYSFS_ENUM_STOP;
+  std::string fullPath = *dirpath ? std::string(dirpath) + "/" + filename
+                                  : std::string(filename);
+  if (data.pathTrans) {
+    const std::string *mixed = data.pathTrans->find(fullPath);
+    if (mixed)
+      fullPath = *mixed;
+  }
+  data.found = fullPath;
+  return PHYSFS_ENUM_STOP;
+}
+
+std::string FileSystem::resolvePath(const char *filename)
+{
+  char buffer[512];
+  FindPathEnumData data;
+  const char *dir;
+  data.filenameN = splitPath(buffer, sizeof(buffer), filename,
+                             p->havePathCache, dir, data.filename);
+  data.pathTrans = p->havePathCache ? &p->pathCache : 0;
+  p->enumerate(dir, findPathEnumCB, &data);
+  return data.found;
+}
+
 void FileSystem::openReadRaw(SDL_RWops &ops, const char *fn, bool freeOnClose)
 {
   PHYSFS_File *handle = PHYSFS_openRead(fn);
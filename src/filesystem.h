@@ -66,6 +66,9 @@ public:
   void openRead(OpenHandler &handler, const char *filename);
 // Circumvents extension supplementing
   void openReadRaw(SDL_RWops &ops, const char *filename, bool freeOnClose = false);
+  /* Full path of the file openRead() would pick first,
+   * with its real case and extension, or empty if none */
+  std::string resolvePath(const char *filename);
 // Does not perform extension supplementing
   bool exists(const char *filename);
   bool exists_ext(const char *filename);
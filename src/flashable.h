@@ -24,6 +24,7 @@
 
 #include "etc.h"
 #include "etc-internal.h"
+#include "scene.h"
 
 class Flashable
 {
@@ -34,6 +35,7 @@ public:
   void flash(const Vec4 *color, int duration)
   {
     if (duration < 1) return;
+    Scene::markChanged();
     flashing = true;
     this->duration = duration;
     counter = 0;
@@ -48,6 +50,7 @@ public:
   virtual void update()
   {
     if (!flashing) return;
+    Scene::markChanged();
     if (++counter > duration) {
       // Flash finished. Cleanup
       flashColor = Vec4(0, 0, 0, 0);
@@ -0,0 +1,226 @@
+/*
+** frameprofiler.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frameprofiler.h"
+#include <SDL_atomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "debugwriter.h"
+
+struct Event
+{
+  uint64_t start, end;
+  uint32_t frame;
+  uint8_t phase;
+};
+
+static const char *phaseNames[] =
+{
+  "ruby",
+  "prepare_draw",
+  "composite",
+  "draw_sprite",
+  "draw_window",
+  "draw_plane",
+  "draw_viewport",
+  "draw_tilemap",
+  "draw_other",
+  "tilemap_rebuild",
+  "texture_upload",
+  "swap",
+  "sleep"
+};
+
+/* Counts every entry ever written, wrapping around past 2^32,
+ * the slot is head % size. 'full' is raised once the ring got
+ * filled up for the first time and stays raised afterwards */
+struct RingHead
+{
+  SDL_atomic_t head;
+  SDL_atomic_t full;
+
+  uint32_t get()
+  {
+    return (uint32_t) SDL_AtomicGet(&head);
+  }
+
+  void publish(uint32_t value, uint32_t size)
+  {
+    if (value >= size)
+      SDL_AtomicSet(&full, 1);
+    SDL_AtomicSet(&head, (int) value);
+  }
+
+  // Number of valid entries in front of 'value'
+  uint32_t count(uint32_t value, uint32_t size)
+  {
+    return SDL_AtomicGet(&full) ? size : std::min(value, size);
+  }
+
+  /* How many of the 'count' entries starting at 'first' the
+   * writer could have overwritten since they were read */
+  uint32_t lapped(uint32_t first, uint32_t count, uint32_t size)
+  {
+    uint32_t ahead = get() - first;
+    return ahead <= size ? 0 : std::min(ahead - size, count);
+  }
+};
+
+static bool active = false;
+static Event events[PROFILER_EVENTS];
+static RingHead eventHead;
+static FrameProfiler::Frame frames[PROFILER_FRAMES];
+static RingHead frameHead;
+// Running frame, only touched by the writing thread
+static uint64_t current[FrameProfiler::PhaseCount];
+static uint64_t frameStart = 0;
+static uint32_t frameIndex = 0;
+static uint64_t scriptStart = 0;
+
+static uint64_t toMicroseconds(uint64_t ticks)
+{
+  static const uint64_t freq = SDL_GetPerformanceFrequency();
+  // Split up so the multiplication can't overflow either
+  return ticks / freq * 1000000 + ticks % freq * 1000000 / freq;
+}
+
+namespace FrameProfiler
+{
+
+bool enabled()
+{
+  return active;
+}
+
+void setEnabled(bool value)
+{
+  if (value == active)
+    return;
+  active = value;
+  memset(current, 0, sizeof(current));
+  frameStart = value ? SDL_GetPerformanceCounter() : 0;
+  scriptStart = 0;
+}
+
+const char *phaseName(int phase)
+{
+  if (phase < 0 || phase >= PhaseCount)
+    return "unknown";
+  return phaseNames[phase];
+}
+
+void record(Phase phase, uint64_t start, uint64_t end)
+{
+  if (!active)
+    return;
+  current[phase] += end - start;
+  uint32_t head = eventHead.get();
+  Event &e = events[head % PROFILER_EVENTS];
+  e.start = start;
+  e.end = end;
+  e.frame = frameIndex;
+  e.phase = phase;
+  eventHead.publish(head + 1, PROFILER_EVENTS);
+}
+
+void endFrame()
+{
+  if (!active)
+    return;
+  uint64_t now = SDL_GetPerformanceCounter();
+  uint32_t head = frameHead.get();
+  Frame &f = frames[head % PROFILER_FRAMES];
+  f.index = frameIndex++;
+  f.total = toMicroseconds(now - frameStart);
+  for (int i = 0; i < PhaseCount; ++i)
+    f.phases[i] = toMicroseconds(current[i]);
+  frameHead.publish(head + 1, PROFILER_FRAMES);
+  memset(current, 0, sizeof(current));
+  frameStart = now;
+}
+
+int lastFrames(Frame *out, int max)
+{
+  if (max <= 0)
+    return 0;
+  uint32_t head = frameHead.get();
+  uint32_t count = std::min(frameHead.count(head, PROFILER_FRAMES), (uint32_t) max);
+  uint32_t first = head - count;
+  for (uint32_t i = 0; i < count; ++i)
+    out[i] = frames[(first + i) % PROFILER_FRAMES];
+  /* The writer may have lapped the oldest slots meanwhile,
+   * drop whatever could have been overwritten */
+  uint32_t lapped = frameHead.lapped(first, count, PROFILER_FRAMES);
+  if (lapped == 0)
+    return count;
+  memmove(out, out + lapped, (count - lapped) * sizeof(Frame));
+  return count - lapped;
+}
+
+bool writeTrace(const char *path)
+{
+  uint32_t head = eventHead.get();
+  uint32_t count = eventHead.count(head, PROFILER_EVENTS);
+  uint32_t first = head - count;
+  std::vector<Event> copy(count);
+  for (uint32_t i = 0; i < count; ++i)
+    copy[i] = events[(first + i) % PROFILER_EVENTS];
+  uint32_t lapped = eventHead.lapped(first, count, PROFILER_EVENTS);
+  copy.erase(copy.begin(), copy.begin() + lapped);
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    Debug() << "Could not write frame trace" << path;
+    return false;
+  }
+  // Outer scopes are recorded after the ones nested in them
+  uint64_t base = copy.empty() ? 0 : copy[0].start;
+  for (size_t i = 1; i < copy.size(); ++i)
+    base = std::min(base, copy[i].start);
+  fputs("{\"traceEvents\":[", f);
+  for (size_t i = 0; i < copy.size(); ++i) {
+    const Event &e = copy[i];
+    fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\","
+               "\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":1,"
+               "\"args\":{\"frame\":%u}}",
+            i ? "," : "", phaseNames[e.phase],
+            (unsigned long long) toMicroseconds(e.start - base),
+            (unsigned long long) toMicroseconds(e.end - e.start),
+            e.frame);
+  }
+  fputs("\n],\"displayTimeUnit\":\"ms\"}\n", f);
+  fclose(f);
+  return true;
+}
+
+UpdateScope::UpdateScope()
+{
+  if (active && scriptStart)
+    record(Ruby, scriptStart, SDL_GetPerformanceCounter());
+}
+
+UpdateScope::~UpdateScope()
+{
+  scriptStart = active ? SDL_GetPerformanceCounter() : 0;
+}
+
+}
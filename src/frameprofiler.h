@@ -0,0 +1,106 @@
+/*
+** frameprofiler.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <SDL_timer.h>
+#include <stdint.h>
+
+/* Both ring sizes are powers of two, so the slot of an
+ * entry stays put once its 32 bit counter wraps around */
+// Number of finished frames kept around for Graphics.frame_stats
+#define PROFILER_FRAMES 256
+// Number of single timings kept around for trace exports
+#define PROFILER_EVENTS 16384
+
+/* Scoped CPU timers around the main phases of a frame. Only the
+ * thread running the game writes samples, into fixed rings whose
+ * head is published atomically once an entry is complete, so any
+ * thread can read them without taking a lock. Timing stays off
+ * until enabled, each scope then costs two counter reads */
+namespace FrameProfiler
+{
+  enum Phase
+  {
+    Ruby,
+    PrepareDraw,
+    Composite,
+    // Top level scene elements, nested inside Composite
+    DrawSprite,
+    DrawWindow,
+    DrawPlane,
+    DrawViewport,
+    DrawTilemap,
+    DrawOther,
+    TilemapRebuild,
+    TextureUpload,
+    Swap,
+    Sleep,
+    PhaseCount
+  };
+
+  // Totals of one frame in microseconds, nested phases are included
+  struct Frame
+  {
+    uint32_t index;
+    uint32_t total;
+    uint32_t phases[PhaseCount];
+  };
+
+  bool enabled();
+  void setEnabled(bool value);
+  const char *phaseName(int phase);
+  void record(Phase phase, uint64_t start, uint64_t end);
+  // Closes the running frame, called once the buffers were swapped
+  void endFrame();
+  // Copies up to 'max' of the most recent frames, oldest first
+  int lastFrames(Frame *out, int max);
+  // Writes every kept timing as Chrome trace event JSON
+  bool writeTrace(const char *path);
+
+  struct Scope
+  {
+    Scope(Phase phase)
+      : phase(phase), start(enabled() ? SDL_GetPerformanceCounter() : 0)
+    {}
+
+    ~Scope()
+    {
+      if (start)
+        record(phase, start, SDL_GetPerformanceCounter());
+    }
+
+  private:
+    Phase phase;
+    uint64_t start;
+  };
+
+  /* Lives for the duration of Graphics.update, whatever
+   * happens in between two calls is counted as Ruby time */
+  struct UpdateScope
+  {
+    UpdateScope();
+    ~UpdateScope();
+  };
+}
+
+#endif // FRAMEPROFILER_H
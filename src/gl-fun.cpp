@@ -150,6 +150,44 @@ void initGLFunctions()
 		GL_VAO_FUN;
 	}
 
+	/* Mappable pixel unpack buffers */
+	if (glMajor >= 3 || (!gles && HAVE_EXT(ARB_pixel_buffer_object) &&
+	                     HAVE_EXT(ARB_map_buffer_range)))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+		GL_PBO_FUN;
+	}
+
+	/* Program binaries, OES doesn't need the retrievable hint */
+	if (HAVE_EXT(ARB_get_program_binary) || (gles && glMajor >= 3))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+		GL_PROGRAM_BINARY_FUN;
+		GL_PROGRAM_PARAM_FUN;
+	}
+	else if (HAVE_EXT(OES_get_program_binary))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX "OES"
+		GL_PROGRAM_BINARY_FUN;
+	}
+
+	/* Timer queries, the GLES flavor can report disjoint results */
+	if (!gles && (HAVE_EXT(ARB_timer_query) || glMajor >= 4))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX ""
+		GL_TIMER_QUERY_FUN;
+	}
+	else if (gles && HAVE_EXT(EXT_disjoint_timer_query))
+	{
+#undef EXT_SUFFIX
+#define EXT_SUFFIX "EXT"
+		GL_TIMER_QUERY_FUN;
+	}
+
 	/* Debug callback entrypoints */
 	if (HAVE_EXT(KHR_debug))
 	{
@@ -173,6 +211,8 @@ void initGLFunctions()
 	// Misc caps
 	if (!gles || glMajor >= 3 || HAVE_EXT(EXT_unpack_subimage))
 		gl.unpack_subimage = true;
+	if (!gles || glMajor >= 3 || HAVE_EXT(NV_pack_subimage))
+		gl.pack_subimage = true;
 	if (!gles || glMajor >= 3 || HAVE_EXT(OES_texture_npot))
 		gl.npot_repeat = true;
 }
@@ -69,6 +69,8 @@ typedef void (APIENTRYP _PFNGLDELETEBUFFERSPROC) (GLsizei n, const GLuint* buffe
 typedef void (APIENTRYP _PFNGLBINDBUFFERPROC) (GLenum target, GLuint buffer);
 typedef void (APIENTRYP _PFNGLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage);
 typedef void (APIENTRYP _PFNGLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data);
+typedef void* (APIENTRYP _PFNGLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRYP _PFNGLUNMAPBUFFERPROC) (GLenum target);
 
 /* Shader */
 typedef GLuint (APIENTRYP _PFNGLCREATESHADERPROC) (GLenum type);
@@ -86,6 +88,17 @@ typedef void (APIENTRYP _PFNGLUSEPROGRAMPROC) (GLuint program);
 typedef void (APIENTRYP _PFNGLLINKPROGRAMPROC) (GLuint program);
 typedef void (APIENTRYP _PFNGLGETPROGRAMIVPROC) (GLuint program, GLenum pname, GLint* param);
 typedef void (APIENTRYP _PFNGLGETPROGRAMINFOLOGPROC) (GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef void (APIENTRYP _PFNGLGETPROGRAMBINARYPROC) (GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP _PFNGLPROGRAMBINARYPROC) (GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP _PFNGLPROGRAMPARAMETERIPROC) (GLuint program, GLenum pname, GLint value);
+
+/* Query */
+typedef void (APIENTRYP _PFNGLGENQUERIESPROC) (GLsizei n, GLuint *ids);
+typedef void (APIENTRYP _PFNGLDELETEQUERIESPROC) (GLsizei n, const GLuint *ids);
+typedef void (APIENTRYP _PFNGLBEGINQUERYPROC) (GLenum target, GLuint id);
+typedef void (APIENTRYP _PFNGLENDQUERYPROC) (GLenum target);
+typedef void (APIENTRYP _PFNGLGETQUERYOBJECTIVPROC) (GLuint id, GLenum pname, GLint *params);
+typedef void (APIENTRYP _PFNGLGETQUERYOBJECTUI64VPROC) (GLuint id, GLenum pname, GLuint64 *params);
 
 /* Uniform */
 typedef GLint (APIENTRYP _PFNGLGETUNIFORMLOCATIONPROC) (GLuint program, const GLchar* name);
@@ -94,6 +107,8 @@ typedef void (APIENTRYP _PFNGLUNIFORM2FPROC) (GLint location, GLfloat v0, GLfloa
 typedef void (APIENTRYP _PFNGLUNIFORM3FPROC) (GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
 typedef void (APIENTRYP _PFNGLUNIFORM4FPROC) (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
 typedef void (APIENTRYP _PFNGLUNIFORM1IPROC) (GLint location, GLint v0);
+typedef void (APIENTRYP _PFNGLUNIFORM1FVPROC) (GLint location, GLsizei count, const GLfloat* value);
+typedef void (APIENTRYP _PFNGLUNIFORM4FVPROC) (GLint location, GLsizei count, const GLfloat* value);
 typedef void (APIENTRYP _PFNGLUNIFORMMATRIX4FVPROC) (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
 
 /* Vertex attribute */
@@ -125,6 +140,33 @@ typedef void (APIENTRYP _PFNGLRELEASESHADERCOMPILERPROC) (void);
 #define GL_UNPACK_ROW_LENGTH 0x0CF2
 #define GL_UNPACK_SKIP_PIXELS 0x0CF4
 #define GL_UNPACK_SKIP_ROWS 0x0CF3
+#define GL_PACK_ROW_LENGTH 0x0D02
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#define GL_STREAM_DRAW 0x88E0
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_MAP_READ_BIT 0x0001
+#endif
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
 #endif
 
 #define GL_20_FUN \
@@ -180,6 +222,8 @@ typedef void (APIENTRYP _PFNGLRELEASESHADERCOMPILERPROC) (void);
   GL_FUN(Uniform3f, _PFNGLUNIFORM3FPROC) \
   GL_FUN(Uniform4f, _PFNGLUNIFORM4FPROC) \
   GL_FUN(Uniform1i, _PFNGLUNIFORM1IPROC) \
+  GL_FUN(Uniform1fv, _PFNGLUNIFORM1FVPROC) \
+  GL_FUN(Uniform4fv, _PFNGLUNIFORM4FVPROC) \
   GL_FUN(UniformMatrix4fv, _PFNGLUNIFORMMATRIX4FVPROC) \
   /* Vertex attribute */ \
   GL_FUN(BindAttribLocation, _PFNGLBINDATTRIBLOCATIONPROC) \
@@ -206,9 +250,31 @@ typedef void (APIENTRYP _PFNGLRELEASESHADERCOMPILERPROC) (void);
   GL_FUN(DeleteVertexArrays, _PFNGLDELETEVERTEXARRAYSPROC) \
   GL_FUN(BindVertexArray, _PFNGLBINDVERTEXARRAYPROC) \
 
+#define GL_PBO_FUN \
+  /* Pixel buffer object mapping */ \
+  GL_FUN(MapBufferRange, _PFNGLMAPBUFFERRANGEPROC) \
+  GL_FUN(UnmapBuffer, _PFNGLUNMAPBUFFERPROC)
+
 #define GL_DEBUG_KHR_FUN \
   GL_FUN(DebugMessageCallback, _PFNGLDEBUGMESSAGECALLBACKPROC)
 
+#define GL_PROGRAM_BINARY_FUN \
+  /* Program binaries */ \
+  GL_FUN(GetProgramBinary, _PFNGLGETPROGRAMBINARYPROC) \
+  GL_FUN(ProgramBinary, _PFNGLPROGRAMBINARYPROC)
+
+#define GL_PROGRAM_PARAM_FUN \
+  GL_FUN(ProgramParameteri, _PFNGLPROGRAMPARAMETERIPROC)
+
+#define GL_TIMER_QUERY_FUN \
+  /* Timer query */ \
+  GL_FUN(GenQueries, _PFNGLGENQUERIESPROC) \
+  GL_FUN(DeleteQueries, _PFNGLDELETEQUERIESPROC) \
+  GL_FUN(BeginQuery, _PFNGLBEGINQUERYPROC) \
+  GL_FUN(EndQuery, _PFNGLENDQUERYPROC) \
+  GL_FUN(GetQueryObjectiv, _PFNGLGETQUERYOBJECTIVPROC) \
+  GL_FUN(GetQueryObjectui64v, _PFNGLGETQUERYOBJECTUI64VPROC)
+
 #define GL_GREMEMDY_FUN \
   GL_FUN(StringMarker, _PFNGLSTRINGMARKERPROC)
 
@@ -221,6 +287,10 @@ struct GLFunctions
   GL_FBO_FUN
   GL_FBO_BLIT_FUN
   GL_VAO_FUN
+  GL_PBO_FUN
+  GL_PROGRAM_BINARY_FUN
+  GL_PROGRAM_PARAM_FUN
+  GL_TIMER_QUERY_FUN
   GL_DEBUG_KHR_FUN
   GL_GREMEMDY_FUN
   //GL_FUN(Begin, _PFNGLBEGINPROC)
@@ -228,6 +298,8 @@ struct GLFunctions
   //GL_FUN(Vertex2f, _PFNGLVERTEX2FPROC)
   bool glsles;
   bool unpack_subimage;
+  // GL_PACK_ROW_LENGTH, on GLES2 only with NV_pack_subimage
+  bool pack_subimage;
   bool npot_repeat;
 #undef GL_FUN
 };
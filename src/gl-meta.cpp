@@ -24,6 +24,7 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "quad.h"
+#include <string.h>
 
 namespace GLMeta
 {
@@ -58,8 +59,71 @@ void subRectImageEnd()
   }
 }
 
+/* Number of buffers cycled through. Each one gets orphaned
+ * before it's written to again, so this only needs to cover
+ * uploads the driver may still have in flight */
+#define STREAM_RING 3
+// Anything smaller isn't worth the buffer round trip
+#define STREAM_MIN_BYTES (16 * 1024)
+
+static struct
+{
+  PBO::ID bo[STREAM_RING];
+  int next;
+  bool init;
+} stream;
+
+void streamSubImage(GLint x, GLint y, GLsizei width, GLsizei height,
+                    const void *data, GLenum format)
+{
+  GLsizeiptr bytes = (GLsizeiptr) width * height * 4;
+  if (!gl.MapBufferRange || bytes < STREAM_MIN_BYTES) {
+    TEX::uploadSubImage(x, y, width, height, data, format);
+    return;
+  }
+  if (!stream.init) {
+    for (int i = 0; i < STREAM_RING; ++i)
+      stream.bo[i] = PBO::gen();
+    stream.init = true;
+  }
+  PBO::bind(stream.bo[stream.next]);
+  stream.next = (stream.next + 1) % STREAM_RING;
+  // Orphan the old storage instead of waiting on the GPU to release it
+  PBO::allocEmpty(bytes, GL_STREAM_DRAW);
+  void *dst = gl.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!dst) {
+    PBO::unbind();
+    TEX::uploadSubImage(x, y, width, height, data, format);
+    return;
+  }
+  memcpy(dst, data, bytes);
+  gl.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  // With a PBO bound the pointer argument is an offset into it
+  TEX::uploadSubImage(x, y, width, height, 0, format);
+  PBO::unbind();
+}
+
+void streamFini()
+{
+  if (!stream.init)
+    return;
+  for (int i = 0; i < STREAM_RING; ++i)
+    PBO::del(stream.bo[i]);
+  stream.init = false;
+}
+
 #define HAVE_NATIVE_VAO gl.GenVertexArrays
 
+static void bindNativeVAO(GLuint name)
+{
+  if (!GLState::needsBind(GLState::bound.vao, name))
+    return;
+  gl.BindVertexArray(name);
+  // The element array binding comes with the VAO
+  IBO::forget();
+}
+
 static void vaoBindRes(VAO &vao)
 {
   VBO::bind(vao.vbo);
@@ -75,9 +139,9 @@ void vaoInit(VAO &vao, bool keepBound)
 {
   if (HAVE_NATIVE_VAO) {
     gl.GenVertexArrays(1, &vao.nativeVAO);
-    gl.BindVertexArray(vao.nativeVAO);
+    bindNativeVAO(vao.nativeVAO);
     vaoBindRes(vao);
-    if (!keepBound) gl.BindVertexArray(0);
+    if (!keepBound) bindNativeVAO(0);
   } else {
     if (keepBound) {
       VBO::bind(vao.vbo);
@@ -88,13 +152,19 @@ void vaoInit(VAO &vao, bool keepBound)
 
 void vaoFini(VAO &vao)
 {
-  if (HAVE_NATIVE_VAO) gl.DeleteVertexArrays(1, &vao.nativeVAO);
+  if (!HAVE_NATIVE_VAO)
+    return;
+  if (GLState::bound.vao == vao.nativeVAO) {
+    GLState::bound.vao = 0;
+    IBO::forget();
+  }
+  gl.DeleteVertexArrays(1, &vao.nativeVAO);
 }
 
 void vaoBind(VAO &vao)
 {
   if (HAVE_NATIVE_VAO)
-    gl.BindVertexArray(vao.nativeVAO);
+    bindNativeVAO(vao.nativeVAO);
   else
     vaoBindRes(vao);
 }
@@ -102,7 +172,7 @@ void vaoBind(VAO &vao)
 void vaoUnbind(VAO &vao)
 {
   if (HAVE_NATIVE_VAO) {
-    gl.BindVertexArray(0);
+    bindNativeVAO(0);
   } else {
     for (size_t i = 0; i < vao.attrCount; ++i)
       gl.DisableVertexAttribArray(vao.attr[i].index);
@@ -131,7 +201,7 @@ void vertex2f(GLfloat x, GLfloat y)
 static void _blitBegin(FBO::ID fbo, const Vec2i &size)
 {
   if (HAVE_NATIVE_BLIT) {
-    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo.gl);
+    FBO::bindDraw(fbo);
     return;
   }
   FBO::bind(fbo);
@@ -155,7 +225,7 @@ void blitBeginScreen(const Vec2i &size)
 void blitSource(TEXFBO &source)
 {
   if (HAVE_NATIVE_BLIT) {
-    gl.BindFramebuffer(GL_READ_FRAMEBUFFER, source.fbo.gl);
+    FBO::bindRead(source.fbo);
     return;
   }
   SimpleShader &shader = shState->shaders().simple;
@@ -36,6 +36,13 @@ void subRectImageUpload(GLint srcW, GLint srcX, GLint srcY,
                         SDL_Surface *src, GLenum format);
 void subRectImageEnd();
 
+/* Uploads into the bound texture through a ring of pixel unpack
+ * buffers, so the copy to VRAM happens asynchronously. Falls back
+ * to a plain TexSubImage for small uploads or without PBO support */
+void streamSubImage(GLint x, GLint y, GLsizei width, GLsizei height,
+                    const void *data, GLenum format);
+void streamFini();
+
 // ARB_vertex_array_object
   struct VAO
   { // Set manually, then call vaoInit()
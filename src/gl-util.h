@@ -24,6 +24,8 @@
 
 #include "gl-fun.h"
 #include "etc-internal.h"
+#include "frameprofiler.h"
+#include "glstate.h"
 
 /* Struct wrapping GLuint for some light type safety */
 #define DEF_GL_ID \
@@ -60,11 +62,28 @@ namespace TEX
 
   static inline void del(ID id)
   {
+    // GL unbinds deleted textures from every unit
+    for (int i = 0; i < GL_CACHED_TEX_UNITS; ++i)
+      if (GLState::bound.tex[i] == id.gl)
+        GLState::bound.tex[i] = 0;
     gl.DeleteTextures(1, &id.gl);
   }
 
+  static inline void setActiveUnit(unsigned unit)
+  {
+    if (GLState::needsBind(GLState::bound.activeUnit, unit))
+      gl.ActiveTexture(GL_TEXTURE0 + unit);
+  }
+  // Binds to the active texture unit
   static inline void bind(ID id)
   {
+    unsigned unit = GLState::bound.activeUnit;
+    if (unit < GL_CACHED_TEX_UNITS) {
+      if (!GLState::needsBind(GLState::bound.tex[unit], id.gl))
+        return;
+    } else {
+      ++GLState::counters.issued;
+    }
     gl.BindTexture(GL_TEXTURE_2D, id.gl);
   }
 
@@ -75,11 +94,15 @@ namespace TEX
 
   static inline void uploadImage(GLsizei width, GLsizei height, const void *data, GLenum format)
   {
+    FrameProfiler::Scope timer(FrameProfiler::TextureUpload);
+    ++GLState::counters.uploads;
     gl.TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, format, GL_UNSIGNED_BYTE, data);
   }
 
   static inline void uploadSubImage(GLint x, GLint y, GLsizei width, GLsizei height, const void *data, GLenum format)
   {
+    FrameProfiler::Scope timer(FrameProfiler::TextureUpload);
+    ++GLState::counters.uploads;
     gl.TexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, GL_UNSIGNED_BYTE, data);
   }
 
@@ -114,14 +137,37 @@ namespace FBO
 
   static inline void del(ID id)
   {
+    if (GLState::bound.drawFBO == id.gl)
+      GLState::bound.drawFBO = 0;
+    if (GLState::bound.readFBO == id.gl)
+      GLState::bound.readFBO = 0;
     gl.DeleteFramebuffers(1, &id.gl);
   }
-
+  // Binds 'id' for both drawing and reading
   static inline void bind(ID id)
   {
+    GLBindCache &b = GLState::bound;
+    if (b.drawFBO == id.gl && b.readFBO == id.gl) {
+      ++GLState::counters.elided;
+      return;
+    }
+    b.drawFBO = b.readFBO = id.gl;
+    ++GLState::counters.issued;
     gl.BindFramebuffer(GL_FRAMEBUFFER, id.gl);
   }
 
+  static inline void bindDraw(ID id)
+  {
+    if (GLState::needsBind(GLState::bound.drawFBO, id.gl))
+      gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, id.gl);
+  }
+
+  static inline void bindRead(ID id)
+  {
+    if (GLState::needsBind(GLState::bound.readFBO, id.gl))
+      gl.BindFramebuffer(GL_READ_FRAMEBUFFER, id.gl);
+  }
+
   static inline void unbind()
   {
     bind(ID(0));
@@ -152,12 +198,21 @@ struct GenericBO
 
   static inline void del(ID id)
   {
+    if (bound == id.gl)
+      bound = 0;
     gl.DeleteBuffers(1, &id.gl);
   }
 
   static inline void bind(ID id)
   {
-    gl.BindBuffer(target, id.gl);
+    if (GLState::needsBind(bound, id.gl))
+      gl.BindBuffer(target, id.gl);
+  }
+  /* For when the binding changed behind our back, eg. element
+   * array buffers are part of the vertex array object state */
+  static inline void forget()
+  {
+    bound = GL_NAME_UNKNOWN;
   }
 
   static inline void unbind()
@@ -179,14 +234,26 @@ struct GenericBO
   {
     uploadData(size, 0, usage);
   }
+
+private:
+  static unsigned int bound; /* GLuint */
 };
 
+template<GLenum target>
+unsigned int GenericBO<target>::bound = GL_NAME_UNKNOWN;
+
 /* Vertex Buffer Object */
 typedef struct GenericBO<GL_ARRAY_BUFFER> VBO;
 
 /* Index Buffer Object */
 typedef struct GenericBO<GL_ELEMENT_ARRAY_BUFFER> IBO;
 
+/* Pixel Unpack Buffer Object */
+typedef struct GenericBO<GL_PIXEL_UNPACK_BUFFER> PBO;
+
+/* Pixel Pack Buffer Object */
+typedef struct GenericBO<GL_PIXEL_PACK_BUFFER> PackBO;
+
 #undef DEF_GL_ID
 
 // Convenience struct wrapping a framebuffer and a 2D texture as its target
@@ -103,6 +103,20 @@ void GLProgram::apply(const unsigned int &value)
   gl.UseProgram(value);
 }
 
+// GL starts out with unit 0 active, whatever else is a guess
+GLBindCache::GLBindCache()
+: activeUnit(0),
+  drawFBO(GL_NAME_UNKNOWN),
+  readFBO(GL_NAME_UNKNOWN),
+  vao(GL_NAME_UNKNOWN)
+{
+  for (int i = 0; i < GL_CACHED_TEX_UNITS; ++i)
+    tex[i] = GL_NAME_UNKNOWN;
+}
+
+GLBindCache GLState::bound;
+GLStateCounters GLState::counters;
+
 GLState::Caps::Caps()
 {
   gl.GetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
@@ -125,3 +139,9 @@ bool GLState::stack_not_null() const
   return viewport.stack_size() > 0;
 }
 
+void GLState::endFrame()
+{
+  lastFrame = counters;
+  counters = GLStateCounters();
+}
+
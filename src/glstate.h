@@ -28,6 +28,35 @@
 
 struct Config;
 
+/* Stands for "no idea what is bound", forcing the next bind through */
+#define GL_NAME_UNKNOWN ((unsigned int) -1)
+#define GL_CACHED_TEX_UNITS 8
+
+/* Names last bound through the TEX, FBO, GenericBO and VAO
+ * helpers, so binding what is already bound becomes a no-op */
+struct GLBindCache
+{
+  unsigned int tex[GL_CACHED_TEX_UNITS]; /* GLuint */
+  unsigned int activeUnit;
+  unsigned int drawFBO, readFBO;
+  unsigned int vao;
+
+  GLBindCache();
+};
+
+/* Calls that reached GL versus the ones dropped because
+ * the state was already set */
+struct GLStateCounters
+{
+  unsigned int issued;
+  unsigned int elided;
+  // Draw calls and texture uploads made
+  unsigned int draws;
+  unsigned int uploads;
+
+  GLStateCounters() : issued(0), elided(0), draws(0), uploads(0) {}
+};
+
 template<typename T>
 struct GLProperty
 {
@@ -45,11 +74,7 @@ struct GLProperty
   void push() { stack.push(current); }
   void pop()  { set(stack.top()); stack.pop(); }
   const T &get()    { return current; }
-  void set(const T &value)
-  {
-    if (value == current) return;
-    init(value);
-  }
+  void set(const T &value);
 
   void pushSet(const T &value)
   {
@@ -133,6 +158,36 @@ public:
 
   GLState(const Config &conf);
   bool stack_not_null() const;
+  /* Returns true if 'value' still needs to be bound and
+   * remembers it as the current one in 'cached' */
+  static bool needsBind(unsigned int &cached, unsigned int value)
+  {
+    if (cached == value) {
+      ++counters.elided;
+      return false;
+    }
+    cached = value;
+    ++counters.issued;
+    return true;
+  }
+  // Call once per frame, 'lastFrame' then holds the frame's totals
+  void endFrame();
+  /* Static as textures and buffers are already
+   * bound before SharedState (and us) exist */
+  static GLBindCache bound;
+  static GLStateCounters counters;
+  GLStateCounters lastFrame;
 };
 
+template<typename T>
+void GLProperty<T>::set(const T &value)
+{
+  if (value == current) {
+    ++GLState::counters.elided;
+    return;
+  }
+  ++GLState::counters.issued;
+  init(value);
+}
+
 #endif // GLSTATE_H
@@ -0,0 +1,172 @@
+/*
+** gputimer.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gputimer.h"
+#include "frameprofiler.h"
+#include "gl-fun.h"
+#include <string.h>
+#include <vector>
+
+#define GPU_TIMER_SLOTS (GPU_TIMER_LATENCY + 1)
+
+struct Segment
+{
+  GLuint query;
+  uint8_t pass;
+};
+
+static const char *passNames[] =
+{
+  "composite",
+  "viewport_effect",
+  "transition",
+  "screen_blit"
+};
+
+// One slot per frame in flight, 'current' is being recorded
+static std::vector<Segment> slots[GPU_TIMER_SLOTS];
+static uint32_t slotFrames[GPU_TIMER_SLOTS];
+static int current = 0;
+static uint32_t frameIndex = 0;
+static std::vector<GLuint> freeQueries;
+// Passes begun but not ended yet, innermost last
+static std::vector<uint8_t> open;
+static GPUTimer::Timings last;
+static bool haveLast = false;
+
+static void startQuery(uint8_t pass)
+{
+  GLuint query;
+  if (freeQueries.empty()) {
+    gl.GenQueries(1, &query);
+  } else {
+    query = freeQueries.back();
+    freeQueries.pop_back();
+  }
+  gl.BeginQuery(GL_TIME_ELAPSED, query);
+  Segment seg = { query, pass };
+  slots[current].push_back(seg);
+}
+
+static void collect(std::vector<Segment> &segs, uint32_t frame)
+{
+  if (segs.empty())
+    return;
+  // Queries finish in order, so the last one stands for all
+  GLint available = 0;
+  gl.GetQueryObjectiv(segs.back().query, GL_QUERY_RESULT_AVAILABLE, &available);
+  GLint disjoint = 0;
+  if (gl.glsles)
+    gl.GetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  if (available && !disjoint) {
+    last.frame = frame;
+    memset(last.passes, 0, sizeof(last.passes));
+    for (size_t i = 0; i < segs.size(); ++i) {
+      GLuint64 ns = 0;
+      gl.GetQueryObjectui64v(segs[i].query, GL_QUERY_RESULT, &ns);
+      last.passes[segs[i].pass] += ns;
+    }
+    haveLast = true;
+  }
+  // Late results are dropped rather than waited for
+  for (size_t i = 0; i < segs.size(); ++i)
+    freeQueries.push_back(segs[i].query);
+  segs.clear();
+}
+
+namespace GPUTimer
+{
+
+bool supported()
+{
+  return gl.GenQueries != 0;
+}
+
+const char *passName(int pass)
+{
+  if (pass < 0 || pass >= PassCount)
+    return "unknown";
+  return passNames[pass];
+}
+
+void begin(Pass pass)
+{
+  if (!open.empty())
+    gl.EndQuery(GL_TIME_ELAPSED);
+  open.push_back(pass);
+  startQuery(pass);
+}
+
+void end()
+{
+  gl.EndQuery(GL_TIME_ELAPSED);
+  open.pop_back();
+  if (!open.empty())
+    startQuery(open.back());
+}
+
+void endFrame()
+{
+  if (!supported())
+    return;
+  slotFrames[current] = frameIndex++;
+  current = (current + 1) % GPU_TIMER_SLOTS;
+  // The slot about to be reused is GPU_TIMER_LATENCY frames old
+  collect(slots[current], slotFrames[current]);
+}
+
+bool lastTimings(Timings &out)
+{
+  if (haveLast)
+    out = last;
+  return haveLast;
+}
+
+void fini()
+{
+  if (!supported())
+    return;
+  for (int i = 0; i < GPU_TIMER_SLOTS; ++i) {
+    for (size_t j = 0; j < slots[i].size(); ++j)
+      freeQueries.push_back(slots[i][j].query);
+    slots[i].clear();
+  }
+  if (!freeQueries.empty())
+    gl.DeleteQueries(freeQueries.size(), &freeQueries[0]);
+  freeQueries.clear();
+  open.clear();
+  haveLast = false;
+}
+
+Scope::Scope(Pass pass)
+  : started(FrameProfiler::enabled() && supported())
+{
+  if (started)
+    begin(pass);
+}
+
+Scope::~Scope()
+{
+  if (started)
+    end();
+}
+
+}
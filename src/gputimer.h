@@ -0,0 +1,74 @@
+/*
+** gputimer.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <stdint.h>
+
+/* Frames a query is left alone before its result gets read,
+ * by then the GPU is done with it and reading never stalls */
+#define GPU_TIMER_LATENCY 3
+
+/* GL_TIME_ELAPSED queries around the main render passes, taken
+ * while FrameProfiler is enabled and the driver supports them.
+ * Only one such query may run at a time, so a nested pass pauses
+ * the outer one and every pass is timed exclusive of its children */
+namespace GPUTimer
+{
+  enum Pass
+  {
+    Composite,
+    ViewportEffect,
+    Transition,
+    ScreenBlit,
+    PassCount
+  };
+
+  // Times of the last frame whose results came back, in nanoseconds
+  struct Timings
+  {
+    uint32_t frame;
+    uint64_t passes[PassCount];
+  };
+
+  bool supported();
+  const char *passName(int pass);
+  void begin(Pass pass);
+  void end();
+  // Called once per swapped frame, collects old results
+  void endFrame();
+  // False until a first frame's results were collected
+  bool lastTimings(Timings &out);
+  // Frees every query, the GL context must still be current
+  void fini();
+
+  struct Scope
+  {
+    Scope(Pass pass);
+    ~Scope();
+
+  private:
+    bool started;
+  };
+}
+
+#endif // GPUTIMER_H
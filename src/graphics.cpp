@@ -36,6 +36,10 @@
 #include "shader.h"
 #include "sharedstate.h"
 #include "texpool.h"
+#include "readback.h"
+#include "pickindex.h"
+#include "gputimer.h"
+#include "benchmark.h"
 #include "movie.h"
 #include "util.h"
 #include "input/input.h"
@@ -48,6 +52,9 @@
 #include <SDL_thread.h>
 #include <algorithm>
 #include <errno.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 #include <sys/time.h>
 #include <unistd.h>
 #include <time.h>
@@ -59,6 +66,27 @@
 #define RATE_MIN 20
 #define RATE_MAX 300
 
+/* Tints applied by the snapshot shader, the alpha channel is
+ * how much of the tinted luma replaces the original color */
+static const Vec4 sepiaTint(1.2f, 1.0f, 0.8f, 0.8f);
+// Graphics.snap_to_color_bitmap, red, green, blue and anything else
+static const Vec4 colorTints[] =
+{
+  Vec4(1.0f, 0.0f, 0.0f, 0.8f),
+  Vec4(0.0f, 1.0f, 0.0f, 0.8f),
+  Vec4(0.0f, 0.0f, 1.0f, 0.8f),
+  Vec4(0.85f, 0.85f, 0.0f, 0.8f)
+};
+// Graphics.snap_to_vignette modes 3 to 7
+static const Vec4 vignetteTints[] =
+{
+  Vec4(0.9f, 0.01f, 0.01f, 0.8f),
+  Vec4(0.01f, 0.9f, 0.01f, 0.8f),
+  Vec4(0.01f, 0.01f, 0.9f, 0.8f),
+  Vec4(0.9f, 0.9f, 0.01f, 0.8f),
+  Vec4(0.01f, 0.01f, 0.01f, 0.8f)
+};
+
 struct PingPong
 {
   TEXFBO rt[2];
@@ -143,13 +171,23 @@ public:
 
   void composite()
   {
+    {
+      FrameProfiler::Scope timer(FrameProfiler::PrepareDraw);
+      shState->prepareDraw();
+    }
+    compositePrepared();
+  }
+  // Same as composite() for callers that already emitted prepareDraw
+  void compositePrepared()
+  {
+    FrameProfiler::Scope timer(FrameProfiler::Composite);
+    GPUTimer::Scope gpuTimer(GPUTimer::Composite);
     w = geometry.rect.w;
     h = geometry.rect.h;
-    shState->prepareDraw();
     pp.startRender();
     glState.viewport.set(IntRect(0, 0, w, h));
     FBO::clear();
-    Scene::composite();
+    compositeProfiled();
     if (!brightEffect)
       return;
     SimpleColorShader &shader = shState->shaders().simpleColor;
@@ -159,161 +197,40 @@ public:
     brightnessQuad.draw();
   }
 
-  void apply_scissors()
-  {
-    composite();
-    Scene::composite();
-    const IntRect &viewpRect = glState.scissorBox.get();
-    const IntRect &screenRect = geometry.rect;
-    pp.swapRender();
-    glState.scissorTest.pushSet(true);
-    glState.scissorBox.pushSet(screenRect);
-  }
-
-  void apply_shader(ShaderBase &shader)
+  /* Runs the front buffer through the snapshot shader into 'target'.
+   * The front buffer itself is left alone, so any other snapshot
+   * taken before the scene changes can skip compositing */
+  void drawSnapshot(TEXFBO &target, const SnapshotEffect &fx)
   {
+    FBO::bind(target.fbo);
+    glState.viewport.set(IntRect(0, 0, w, h));
+    SnapshotShader &shader = shState->shaders().snapshot;
+    shader.bind();
     shader.applyViewportProj();
     shader.setTexSize(Vec2i(w, h));
-    TEX::bind(pp.backBuffer().tex);
+    shader.setResolution(Vec2i(w, h));
+    shader.setEffect(fx);
+    TEX::bind(pp.frontBuffer().tex);
     glState.blend.pushSet(false);
     screenQuad.draw();
     glState.blend.pop();
-    glState.scissorBox.pop();
-    glState.scissorTest.pop();
-  }
-
-  void composite_gray()
-  {
-    apply_scissors();
-    GrayShader &shader = shState->shaders().gray;
-    shader.bind();
-    shader.setGray(1.0);
-    apply_shader(shader);
-  }
-
-  void composite_sepia()
-  {
-    apply_scissors();
-    SepiaShader &shader = shState->shaders().sepia;
-    shader.bind();
-    apply_shader(shader);
-  }
-
-  void composite_color(int c)
-  {
-    float r = 0.0, g = 0.0, b = 0.0;
-    if (c == 0)
-      r = 1.0;
-    else if (c == 1)
-      g = 1.0;
-    else if (c == 2)
-      b = 1.0;
-    else {
-      r = 0.85;
-      g = 0.85;
-    }
-    apply_scissors();
-    BasicColorShader &shader = shState->shaders().basic_color;
-    shader.bind();
-    shader.set_color(r, g, b);
-    apply_shader(shader);
-  }
-
-  void composite_gradient(const Vec2i &origin, const Vec4 &c1, const Vec4 &c2)
-  {
-    apply_scissors();
-    GradientShader &shader = shState->shaders().gradient;
-    shader.bind();
-    shader.set_origin(origin);
-    shader.set_resolution(w, h);
-    shader.set_colors(c1, c2);
-    apply_shader(shader);
-  }
-
-  void composite_map_gradient(int o, const Vec2i &pt, const Vec4 &c1, const Vec4 &c2)
-  {
-    apply_scissors();
-    GradientMapShader &shader = shState->shaders().gradient_map;
-    shader.bind();
-    shader.set_opacity(o);
-    shader.set_origin(pt);
-    shader.set_resolution(w, h);
-    shader.set_colors(c1, c2);
-    apply_shader(shader);
-  }
-  
-  void bind_vignette_shader(VignetteShader &shader)
-  {
-    shader.bind();
-    shader.set_resolution(w, h);
-    apply_shader(shader);
-  }
-
-  void composite_vignette()
-  {
-    apply_scissors();
-    VignetteShader &shader = shState->shaders().vignette;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_gray_vignette()
-  {
-    apply_scissors();
-    GrayVignetteShader &shader = shState->shaders().vignette_gray;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_sepia_vignette()
-  {
-    apply_scissors();
-    SepiaVignetteShader &shader = shState->shaders().vignette_sepia;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_red_vignette()
-  {
-    apply_scissors();
-    RedVignetteShader &shader = shState->shaders().vignette_red;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_green_vignette()
-  {
-    apply_scissors();
-    GreenVignetteShader &shader = shState->shaders().vignette_green;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_blue_vignette()
-  {
-    apply_scissors();
-    BlueVignetteShader &shader = shState->shaders().vignette_blue;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_yellow_vignette()
-  {
-    apply_scissors();
-    YellowVignetteShader &shader = shState->shaders().vignette_yellow;
-    bind_vignette_shader(shader);
-  }
-
-  void composite_black_vignette()
-  {
-    apply_scissors();
-    BlackVignetteShader &shader = shState->shaders().vignette_black;
-    bind_vignette_shader(shader);
   }
 
   void requestViewportRender(const Vec4 &c, const Vec4 &f, const Vec4 &t)
   {
+    GPUTimer::Scope gpuTimer(GPUTimer::ViewportEffect);
     const IntRect &viewpRect = glState.scissorBox.get();
     const IntRect &screenRect = geometry.rect;
-    const bool toneRGBEffect  = t.xyzNotNull();
+    const bool toneAddEffect  = t.x > 0 || t.y > 0 || t.z > 0;
+    const bool toneSubEffect  = t.x < 0 || t.y < 0 || t.z < 0;
     const bool toneGrayEffect = t.w != 0;
     const bool colorEffect    = c.w > 0;
     const bool flashEffect    = f.w > 0;
-    if (toneGrayEffect) {
+    // Color and flash get blended over the scene as one quad
+    int blendPasses = toneAddEffect + toneSubEffect + (colorEffect || flashEffect);
+    if (toneGrayEffect || blendPasses > 1) {
+      /* Gray needs to read the scene anyway, and a single pass
+       * over a copy is cheaper than several blended ones */
       pp.swapRender();
       if (!viewpRect.encloses(screenRect)) {
         /* Scissor test _does_ affect FBO blit operations,
@@ -326,59 +243,50 @@ public:
         GLMeta::blitEnd();
         glState.scissorTest.pop();
       }
-      GrayShader &shader = shState->shaders().gray;
+      ViewportEffectShader &shader = shState->shaders().viewportEffect;
       shader.bind();
-      shader.setGray(t.w);
+      shader.setTone(t);
+      shader.setColor(colorEffect ? c : Vec4());
+      shader.setFlash(flashEffect ? f : Vec4());
       shader.applyViewportProj();
       shader.setTexSize(screenRect.size());
       TEX::bind(pp.backBuffer().tex);
       glState.blend.pushSet(false);
       screenQuad.draw();
       glState.blend.pop();
+      return;
     }
-    if (!toneRGBEffect && !colorEffect && !flashEffect)
+    if (blendPasses == 0)
       return;
     FlatColorShader &shader = shState->shaders().flatColor;
     shader.bind();
     shader.applyViewportProj();
-    if (toneRGBEffect) {
-      /* First split up additive / substractive components */
-      Vec4 add, sub;
-      if (t.x > 0)
-        add.x = t.x;
-      if (t.y > 0)
-        add.y = t.y;
-      if (t.z > 0)
-        add.z = t.z;
-      if (t.x < 0)
-        sub.x = -t.x;
-      if (t.y < 0)
-        sub.y = -t.y;
-      if (t.z < 0)
-        sub.z = -t.z;
-      /* Then apply them using hardware blending */
+    if (toneAddEffect || toneSubEffect) {
+      // Only one of them is set, apply it using hardware blending
       gl.BlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE);
-      if (add.xyzNotNull()) {
+      if (toneAddEffect) {
         gl.BlendEquation(GL_FUNC_ADD);
-        shader.setColor(add);
-        screenQuad.draw();
-      }
-      if (sub.xyzNotNull()) {
+        shader.setColor(Vec4(std::max(t.x, 0.0f), std::max(t.y, 0.0f),
+                             std::max(t.z, 0.0f), 0));
+      } else {
         gl.BlendEquation(GL_FUNC_REVERSE_SUBTRACT);
-        shader.setColor(sub);
-        screenQuad.draw();
+        shader.setColor(Vec4(std::max(-t.x, 0.0f), std::max(-t.y, 0.0f),
+                             std::max(-t.z, 0.0f), 0));
+      }
+      screenQuad.draw();
+    } else {
+      /* Blending flash over color equals blending one color whose
+       * alpha covers what both of them together let through */
+      Vec4 mixed = colorEffect ? c : f;
+      if (colorEffect && flashEffect) {
+        float alpha = 1.0f - (1.0f - c.w) * (1.0f - f.w);
+        float cw = c.w * (1.0f - f.w) / alpha, fw = f.w / alpha;
+        mixed = Vec4(c.x * cw + f.x * fw, c.y * cw + f.y * fw,
+                     c.z * cw + f.z * fw, alpha);
       }
-    }
-    if (colorEffect || flashEffect) {
       gl.BlendEquation(GL_FUNC_ADD);
       gl.BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
-    }
-    if (colorEffect) {
-      shader.setColor(c);
-      screenQuad.draw();
-    }
-    if (flashEffect) {
-      shader.setColor(f);
+      shader.setColor(mixed);
       screenQuad.draw();
     }
     glState.blendMode.refresh();
@@ -421,6 +329,31 @@ private:
 
 /* Nanoseconds per second */
 #define NS_PER_S 1000000000
+// Number of short sleeps FPSLimiter::calibrate() measures
+#define PACER_CALIBRATION_RUNS 20
+
+static void sleepTicks(uint64_t ticks, uint64_t tickFreq)
+{
+#ifdef __linux__
+  uint64_t ns = ticks * NS_PER_S / tickFreq;
+  timespec ts;
+  ts.tv_sec = ns / NS_PER_S;
+  ts.tv_nsec = ns % NS_PER_S;
+  while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR);
+#else
+  SDL_Delay(ticks * 1000 / tickFreq);
+#endif
+}
+
+static void yieldThread()
+{
+#ifdef __linux__
+  sched_yield();
+#else
+  // Sleep(0) on Windows, gives up the rest of the time slice
+  SDL_Delay(0);
+#endif
+}
 
 struct FPSLimiter
 {
@@ -434,6 +367,12 @@ struct FPSLimiter
   /* Ticks per nanosecond */
   const double tickFreqNS;
   bool disabled;
+  /* How long before the deadline sleeping stops and
+   * delayTicks() spins instead, covers wake-up latency */
+  uint64_t spinMargin;
+  /* Frame to frame times, the last bin takes anything longer */
+  uint32_t histogram[FRAME_HIST_BINS];
+  uint64_t lastFrame;
   /* Data for frame timing adjustment */
   struct
   {
@@ -449,9 +388,11 @@ struct FPSLimiter
         tickFreq(SDL_GetPerformanceFrequency()),
         tickFreqMS(tickFreq / 1000),
         tickFreqNS((double) tickFreq / NS_PER_S),
-        disabled(false)
+        disabled(false),
+        spinMargin(tickFreqMS * 3 / 2)
   { // std::cout << "SDL Frequency " << SDL_GetPerformanceFrequency() << std::endl;
     setDesiredFPS(desiredFPS);
+    resetHistogram();
     adj.last = SDL_GetPerformanceCounter();
     adj.idealDiff = 0;
     adj.resetFlag = false;
@@ -495,11 +436,50 @@ struct FPSLimiter
   {
     return (disabled ? false : adj.idealDiff > tpf);
   }
+  /* Measures how late short sleeps actually return and spins
+   * for that long (plus some slack) from then on. Returns the
+   * new spin margin in microseconds */
+  int calibrate()
+  {
+    uint64_t worst = 0;
+    for (int i = 0; i < PACER_CALIBRATION_RUNS; ++i) {
+      uint64_t start = SDL_GetPerformanceCounter();
+      sleepTicks(tickFreqMS, tickFreq);
+      uint64_t slept = SDL_GetPerformanceCounter() - start;
+      if (slept > tickFreqMS)
+        worst = std::max(worst, slept - tickFreqMS);
+    }
+    spinMargin = worst + worst / 2;
+    spinMargin = std::max(spinMargin, tickFreqMS / 4);
+    spinMargin = std::min(spinMargin, tickFreqMS * 4);
+    return spinMargin * 1000000 / tickFreq;
+  }
+  // Call once per presented frame, vsync or not
+  void recordFrame()
+  {
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t us = (now - lastFrame) * 1000000 / tickFreq;
+    lastFrame = now;
+    histogram[std::min<uint64_t>(us / FRAME_HIST_BIN_US, FRAME_HIST_BINS - 1)]++;
+  }
+
+  void resetHistogram()
+  {
+    std::fill(histogram, histogram + FRAME_HIST_BINS, 0);
+    lastFrame = SDL_GetPerformanceCounter();
+  }
 
 private:
+  /* SDL_Delay alone is off by up to a millisecond plus whatever
+   * the scheduler adds, so sleep until 'spinMargin' before the
+   * deadline and yield the rest away */
   void delayTicks(uint64_t ticks)
   {
-    SDL_Delay(ticks / tickFreqMS);
+    const uint64_t deadline = SDL_GetPerformanceCounter() + ticks;
+    if (ticks > spinMargin)
+      sleepTicks(ticks - spinMargin, tickFreq);
+    while (SDL_GetPerformanceCounter() < deadline)
+      yieldThread();
   }
 };
 
@@ -529,6 +509,9 @@ struct GraphicsPrivate
   bool block_fullscreen;
   bool block_ftwelve;
   bool obscured_dirty;
+  // The PP front buffer holds the scene as of 'drawnEpoch'
+  bool sceneValid;
+  unsigned int drawnEpoch;
   bool frozen;
   bool frame_skip;
   bool vsync;
@@ -540,6 +523,8 @@ struct GraphicsPrivate
   IntruList<Disposable> dispList;
   std::vector<uint8_t> obscured_map;
   TEX::ID obscuredTex;
+  ReadbackQueue readback;
+  PickIndex pickIndex;
 
   GraphicsPrivate(RGSSThreadData *rtData)
   : scRes(WIDTH_MAX, HEIGHT_MAX),
@@ -554,13 +539,16 @@ struct GraphicsPrivate
     size_factor(1),
     fpsLimiter(frameRate),
     obscured_dirty(false),
+    sceneValid(false),
+    drawnEpoch(0),
     frozen(false),
     frame_skip(false),
     vsync(false),
     last_update(0),
     last_avg_update(0),
     block_fullscreen(false),
-    block_ftwelve(false)
+    block_ftwelve(false),
+    pickIndex(scRes.x, scRes.y)
   {
     int w = scRes.x;
     int h = scRes.y;
@@ -583,6 +571,7 @@ struct GraphicsPrivate
 
   ~GraphicsPrivate()
   {
+    GPUTimer::fini();
     TEXFBO::fini(frozenScene);
   }
   // Enforces fixed aspect ratio, if desired
@@ -647,6 +636,9 @@ struct GraphicsPrivate
 
   void shutdown()
   {
+    // Closing the window ends a run too, before the main thread moves on
+    if (Benchmark::active())
+      Benchmark::finish();
     threadData->rqTermAck.set();
     shState->texPool().disable();
     scriptBinding->terminate();
@@ -654,8 +646,24 @@ struct GraphicsPrivate
 
   void swapGLBuffer()
   {
-    fpsLimiter.delay();
-    SDL_GL_SwapWindow(threadData->window);
+    {
+      FrameProfiler::Scope timer(FrameProfiler::Sleep);
+      fpsLimiter.delay();
+    }
+    {
+      FrameProfiler::Scope timer(FrameProfiler::Swap);
+      SDL_GL_SwapWindow(threadData->window);
+    }
+    fpsLimiter.recordFrame();
+    glState.endFrame();
+    FrameProfiler::endFrame();
+    GPUTimer::endFrame();
+    const GLStateCounters &calls = glState.lastFrame;
+    if (Benchmark::endFrame(frameRate, calls.draws, calls.uploads)) {
+      // Quit the same way closing the window does
+      Benchmark::finish();
+      threadData->ethread->requestTerminate();
+    }
     ++frameCount;
     threadData->ethread->notifyFrame();
   }
@@ -668,67 +676,37 @@ struct GraphicsPrivate
     GLMeta::blitEnd();
   }
 
-  void compositeToBuffer(TEXFBO &buffer)
-  {
-    screen.composite();
-    set_buffer(buffer);
-  }
-
-  void composite_to_gray_buffer(TEXFBO &buffer)
+  // Makes sure the front buffer holds the current scene
+  void ensureComposited()
   {
-    screen.composite_gray();
-    set_buffer(buffer);
-  }
-
-  void composite_to_sepia_buffer(TEXFBO &buffer)
-  {
-    screen.composite_sepia();
-    set_buffer(buffer);
-  }
-
-  void composite_to_color_buffer(TEXFBO &buffer, int c)
-  {
-    screen.composite_color(c);
-    set_buffer(buffer);
+    /* Pending uploads still need to run, they are what might
+     * change the scene */
+    {
+      FrameProfiler::Scope timer(FrameProfiler::PrepareDraw);
+      shState->prepareDraw();
+    }
+    if (sceneValid && Scene::epoch() == drawnEpoch)
+      return;
+    screen.compositePrepared();
+    drawnEpoch = Scene::epoch();
+    sceneValid = true;
   }
 
-  void composite_to_gradient_buffer(TEXFBO &buffer, const Vec2i &origin,
-                                    const Vec4 &c1, const Vec4 &c2)
+  void compositeToBuffer(TEXFBO &buffer)
   {
-    screen.composite_gradient(origin, c1, c2);
+    ensureComposited();
     set_buffer(buffer);
   }
 
-  void composite_to_map_gradient_buffer(TEXFBO &buf, int op, const Vec2i &origin,
-                                        const Vec4 &c1, const Vec4 &c2)
+  void snapshotToBuffer(TEXFBO &buffer, const SnapshotEffect &fx)
   {
-    screen.composite_map_gradient(op, origin, c1, c2);
-    set_buffer(buf);
-  }
-
-  void composite_to_vignette_buffer(TEXFBO &buffer, int mode)
-  {
-    if (mode == 0)
-      screen.composite_vignette();
-    else if (mode == 1)
-      screen.composite_gray_vignette();
-    else if (mode == 2)
-      screen.composite_sepia_vignette();
-    else if (mode == 3)
-      screen.composite_red_vignette();
-    else if (mode == 4)
-      screen.composite_green_vignette();
-    else if (mode == 5)
-      screen.composite_blue_vignette();
-    else if (mode == 6)
-      screen.composite_yellow_vignette();
-    else if (mode == 7)
-      screen.composite_black_vignette();
-    set_buffer(buffer);
+    ensureComposited();
+    screen.drawSnapshot(buffer, fx);
   }
 
   void metaBlitBufferFlippedScaled()
   {
+    GPUTimer::Scope gpuTimer(GPUTimer::ScreenBlit);
     GLMeta::blitRectangle(IntRect(0, 0, scRes.x, scRes.y),
         IntRect(scOffset.x, scSize.y+scOffset.y, scSize.x, -scSize.y),
         threadData->config.smoothScaling);
@@ -746,8 +724,10 @@ struct GraphicsPrivate
       TEX::uploadSubImage(0, 0, w, h, obscured_map.data(), GL_RED);
 #endif
       obscured_dirty = false;
+      Scene::markChanged();
     }
-    screen.composite();
+    // Without any change the last composited frame is presented again
+    ensureComposited();
     GLMeta::blitBeginScreen(winSize);
     GLMeta::blitSource(screen.getPP().frontBuffer());
     FBO::clear();
@@ -789,10 +769,17 @@ Graphics::Graphics(RGSSThreadData *data) :
   } else if (data->config.fixedFramerate < 0) {
     p->fpsLimiter.disabled = true;
   }
+  // Frames are rendered back to back on a simulated clock
+  if (data->config.benchmark) {
+    p->fpsLimiter.disabled = true;
+    Benchmark::start(data->config.benchmarkFrames, data->config.benchmarkReport);
+  }
 }
 
 Graphics::~Graphics()
-{
+{ /* Scripts may return or fail while a run is still going */
+  if (Benchmark::active())
+    Benchmark::finish();
   delete p;
 }
 
@@ -847,9 +834,11 @@ unsigned long long Graphics::lastUpdate() {
 
 void Graphics::update()
 {
+  FrameProfiler::UpdateScope profile;
   p->last_update = shState->runTime();
   p->checkShutDownReset();
   p->checkSyncLock();
+  p->readback.poll();
   if (p->frozen)
     return;
   if (p->fpsLimiter.frameSkipRequired()) {
@@ -943,9 +932,12 @@ void Graphics::transition(int duration, const char *filename, int vague)
     }
     /* Draw the composed frame to a buffer first
      * (we need this because we're skipping PingPong) */
-    FBO::bind(transBuffer.fbo);
-    FBO::clear();
-    p->screenQuad.draw();
+    {
+      GPUTimer::Scope gpuTimer(GPUTimer::Transition);
+      FBO::bind(transBuffer.fbo);
+      FBO::clear();
+      p->screenQuad.draw();
+    }
     p->checkResize();
     // Then blit it flipped and scaled to the screen
     FBO::unbind();
@@ -959,6 +951,7 @@ void Graphics::transition(int duration, const char *filename, int vague)
   glState.blend.pop();
   delete transMap;
   p->frozen = false;
+  p->sceneValid = false;
 }
 
 void Graphics::frameReset()
@@ -1041,28 +1034,35 @@ Bitmap *Graphics::snapToBitmap()
   return bitmap;
 }
 
-Bitmap *Graphics::snap_to_gray_bitmap()
+Bitmap *Graphics::snapWithEffect(const SnapshotEffect &fx, bool taint)
 {
   Bitmap *bitmap = new Bitmap(width(), height());
-  p->composite_to_gray_buffer(bitmap->getGLTypes());
-  bitmap->taintArea(IntRect(0, 0, width(), height()));
+  p->snapshotToBuffer(bitmap->getGLTypes(), fx);
+  if (taint)
+    bitmap->taintArea(IntRect(0, 0, width(), height()));
   return bitmap;
 }
 
+Bitmap *Graphics::snap_to_gray_bitmap()
+{
+  SnapshotEffect fx;
+  fx.gray = 1.0f;
+  return snapWithEffect(fx, true);
+}
+
 Bitmap *Graphics::snap_to_sepia_bitmap()
 {
-  Bitmap *bitmap = new Bitmap(width(), height());
-  p->composite_to_sepia_buffer(bitmap->getGLTypes());
-  bitmap->taintArea(IntRect(0, 0, width(), height()));
-  return bitmap;
+  SnapshotEffect fx;
+  fx.tint = sepiaTint;
+  return snapWithEffect(fx, true);
 }
 
 Bitmap *Graphics::snap_to_color_bitmap(int c)
 {
-  Bitmap *bitmap = new Bitmap(width(), height());
-  p->composite_to_color_buffer(bitmap->getGLTypes(), c);
-  bitmap->taintArea(IntRect(0, 0, width(), height()));
-  return bitmap;
+  SnapshotEffect fx;
+  fx.gray = 1.0f;
+  fx.tint = colorTints[c >= 0 && c < 3 ? c : 3];
+  return snapWithEffect(fx, true);
 }
 
 Bitmap *Graphics::gradient_bitmap(const Vec4 &c1, const Vec4 &c2, int mode)
@@ -1074,26 +1074,34 @@ Bitmap *Graphics::gradient_bitmap(const Vec4 &c1, const Vec4 &c2, int mode)
 
 Bitmap *Graphics::snap_to_gradient_bitmap(Vec2i &o, Vec4 &c1, Vec4 &c2)
 {
-  Bitmap *bitmap = new Bitmap(width(), height());
-  p->composite_to_gradient_buffer(bitmap->getGLTypes(), o, c1, c2);
-  return bitmap;
+  return snap_to_map_gradient_bitmap(255, o, c1, c2);
 }
 
 Bitmap *Graphics::snap_to_map_gradient_bitmap(int op, Vec2i &o, Vec4 &c1, Vec4 &c2)
 {
-  Bitmap *bitmap = new Bitmap(width(), height());
-  p->composite_to_map_gradient_buffer(bitmap->getGLTypes(), op, o, c1, c2);
-  return bitmap;
+  SnapshotEffect fx;
+  fx.gradient = op / 255.0f;
+  // The origin comes in percent of the screen size
+  fx.origin = Vec2(o.x / 100.0f, o.y / 100.0f);
+  fx.c1 = c1;
+  fx.c2 = c2;
+  return snapWithEffect(fx, false);
 }
 
 Bitmap *Graphics::snap_to_vignette(int mode)
 {
-  Bitmap *bitmap = new Bitmap(width(), height());
-  p->composite_to_vignette_buffer(bitmap->getGLTypes(), mode);
-  return bitmap;
+  SnapshotEffect fx;
+  fx.vignette = 1.0f;
+  if (mode == 1)
+    fx.gray = 1.0f;
+  else if (mode == 2)
+    fx.tint = sepiaTint;
+  else if (mode > 2 && mode < 8)
+    fx.tint = vignetteTints[mode - 3];
+  return snapWithEffect(fx, false);
 }
 
-bool Graphics::save_screenshot()
+std::string Graphics::next_screenshot_path() const
 {
   time_t rt = time(NULL);
   tm *tmp = localtime(&rt);
@@ -1104,6 +1112,13 @@ bool Graphics::save_screenshot()
           tmp->tm_year+1900, tmp->tm_mon+1, tmp->tm_mday,
           tmp->tm_hour, tmp->tm_min, tmp->tm_sec,
           screenshot_format.c_str());
+  return str;
+}
+
+bool Graphics::save_screenshot()
+{
+  std::string path = next_screenshot_path();
+  const char *str = path.c_str();
   Bitmap *bmp = snapToBitmap();
   SDL_Surface *surf = bmp->surface();//Fast
   SDL_LockSurface(surf);
@@ -1124,6 +1139,43 @@ bool Graphics::save_screenshot()
   return !failed;
 }
 
+int Graphics::save_screenshot_async()
+{
+  std::string path = next_screenshot_path();
+  TEXFBO tex = shState->texPool().request(width(), height());
+  p->compositeToBuffer(tex);
+  int ticket = p->readback.request(tex, path, screenshot_format_index == 0);
+  // The queued read still sees the contents, GL keeps commands in order
+  shState->texPool().release(tex);
+  return ticket;
+}
+
+int Graphics::screenshot_status(int ticket) const
+{
+  return p->readback.status(ticket);
+}
+
+std::string Graphics::screenshot_path(int ticket) const
+{
+  return p->readback.path(ticket);
+}
+
+void Graphics::finished_screenshots(std::vector<int> &tickets)
+{
+  p->readback.takeFinished(tickets);
+}
+
+void Graphics::forget_screenshot(int ticket)
+{
+  p->readback.forget(ticket);
+}
+
+void *Graphics::pick(int x, int y) const
+{
+  PickEntry *entry = p->pickIndex.pick(x, y);
+  return entry ? entry->data : 0;
+}
+
 int Graphics::width() const
 {
   return p->scRes.x;
@@ -1145,6 +1197,8 @@ void Graphics::resizeScreen(int w, int h, bool center)
   Vec2i size(w, h);
   p->scRes = size;
   p->screen.setResolution(w, h);
+  p->sceneValid = false;
+  p->pickIndex.resize(w, h);
   TEXFBO::allocEmpty(p->frozenScene, w, h);
   FloatRect screenRect(0, 0, w, h);
   p->screenQuad.setTexPosRect(screenRect, screenRect);
@@ -1238,6 +1292,7 @@ void Graphics::setBrightness(int value)
     return;
   p->brightness = value;
   p->screen.setBrightness(value / 255.0);
+  Scene::markChanged();
 }
 
 void Graphics::reset()
@@ -1254,6 +1309,7 @@ void Graphics::reset()
   p->fpsLimiter.resetFrameAdjust();
   p->frozen = false;
   p->screen.getPP().clearBuffers();
+  p->sceneValid = false;
   setFrameRate(DEF_FRAMERATE);
   setBrightness(255);
 }
@@ -1302,7 +1358,7 @@ void Graphics::set_vsync(bool value)
 {
   if (value)
     p->frameRate = shState->rtData().refreshRate;
-  p->fpsLimiter.disabled = value;
+  p->fpsLimiter.disabled = value || Benchmark::active();
   p->vsync = value;
 }
 
@@ -1350,11 +1406,42 @@ void Graphics::repaintWait(const AtomicFlag &exitCond, bool checkReset)
   GLMeta::blitEnd();
 }
 
+int Graphics::calibrateFramePacer()
+{
+  int margin = p->fpsLimiter.calibrate();
+  p->fpsLimiter.resetFrameAdjust();
+  return margin;
+}
+
+void Graphics::getFrameHistogram(std::vector<uint32_t> &out) const
+{
+  const uint32_t *hist = p->fpsLimiter.histogram;
+  out.assign(hist, hist + FRAME_HIST_BINS);
+}
+
+void Graphics::resetFrameHistogram()
+{
+  p->fpsLimiter.resetHistogram();
+}
+
+bool Graphics::finishBenchmark()
+{
+  if (!Benchmark::finish())
+    return false;
+  p->threadData->ethread->requestTerminate();
+  return true;
+}
+
 const TEX::ID &Graphics::obscuredTex() const
 {
   return p->obscuredTex;
 }
 
+PickIndex &Graphics::pickIndex()
+{
+  return p->pickIndex;
+}
+
 void Graphics::addDisposable(Disposable *d)
 {
   p->dispList.append(d->link);
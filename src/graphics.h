@@ -26,12 +26,20 @@
 #include "util.h"
 #include "etc.h"
 #include "gl-util.h"
+#include <stdint.h>
+#include <vector>
+
+// Bucket width and count of the frame time histogram
+#define FRAME_HIST_BIN_US 250
+#define FRAME_HIST_BINS 128
 
 class Scene;
+class PickIndex;
 class Bitmap;
 class Disposable;
 struct RGSSThreadData;
 struct GraphicsPrivate;
+struct SnapshotEffect;
 struct AtomicFlag;
 struct THEORAPLAY_VideoFrame;
 struct Movie;
@@ -77,6 +85,19 @@ public:
   Bitmap *gradient_bitmap(const Vec4 &c1, const Vec4 &c2, int mode);
   Bitmap *snap_to_vignette(int mode);
   bool save_screenshot();
+  /* Returns a ticket right away, the file gets written once the
+   * pixels arrive a few frames later. Status: 0 pending, 1 saved,
+   * -1 failed, -2 unknown ticket. Finished tickets are forgotten
+   * once their callback ran or when too many piled up */
+  int save_screenshot_async();
+  int screenshot_status(int ticket) const;
+  std::string screenshot_path(int ticket) const;
+  // Tickets finished since the last call, for running Ruby callbacks
+  void finished_screenshots(std::vector<int> &tickets);
+  void forget_screenshot(int ticket);
+  /* Object data of the topmost pickable element
+   * at (x, y) as of the last frame, 0 if none */
+  void *pick(int x, int y) const;
   int width() const;
   int height() const;
   void resizeScreen(int width=0, int height=0, bool center=true);
@@ -100,12 +121,21 @@ public:
   void set_frame_skip(bool value);
   void set_vsync(bool value);
   void set_obscured_dirty(bool value);
+  /* Measures the scheduler's wake-up latency and adjusts
+   * the frame pacer to it, returns its margin in microseconds */
+  int calibrateFramePacer();
+  // Frames per FRAME_HIST_BIN_US wide bucket of frame time
+  void getFrameHistogram(std::vector<uint32_t> &out) const;
+  void resetFrameHistogram();
+  // Ends a --benchmark run early and quits once the report is written
+  bool finishBenchmark();
   /* <internal> */
   Scene *getScreen() const;
   /* Repaint screen with static image until exitCond is set.
    * Observes reset flag on top of shutdown if "checkReset" */
   void repaintWait(const AtomicFlag &exitCond, bool checkReset = true);
   const TEX::ID &obscuredTex() const;
+  PickIndex &pickIndex();
   void call_delay();
 
 private:
@@ -116,8 +146,10 @@ private:
   ~Graphics();
   void addDisposable(Disposable *);
   void remDisposable(Disposable *);
+  Bitmap *snapWithEffect(const SnapshotEffect &fx, bool taint);
   friend struct SharedStatePrivate;
   friend class Disposable;
+  std::string next_screenshot_path() const;
   GraphicsPrivate *p;
 };
 
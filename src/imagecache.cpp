@@ -0,0 +1,205 @@
+/*
+** imagecache.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imagecache.h"
+#include "sharedstate.h"
+#include "filesystem.h"
+#include "texpool.h"
+#include "intrulist.h"
+#include "boost-hash.h"
+#include "debugwriter.h"
+#include <utility>
+#include <assert.h>
+
+typedef std::pair<std::string, int> CacheKey;
+
+struct ImageCacheEntry
+{
+  CacheKey key;
+  TEXFBO tex;
+  int refCount;
+  /* Replaced by a newer entry under the same key */
+  bool orphaned;
+  /* Linked into the idle list while refCount is 0 */
+  IntruListLink<ImageCacheEntry> link;
+
+  ImageCacheEntry(const CacheKey &key, const TEXFBO &tex)
+  : key(key), tex(tex), refCount(0), orphaned(false), link(this) {}
+
+  uint64_t byteCount() const
+  {
+    return (uint64_t) tex.width * tex.height * 4;
+  }
+};
+
+struct ImageCachePrivate
+{
+  BoostHash<CacheKey, ImageCacheEntry*> entries;
+  /* Unreferenced entries, most recently released first */
+  IntruList<ImageCacheEntry> idle;
+  uint64_t budget;
+  uint64_t bytes;
+  uint64_t hits, misses, evictions;
+  int entryCount;
+
+  ImageCachePrivate(uint64_t budget)
+  : budget(budget), bytes(0), hits(0), misses(0), evictions(0), entryCount(0)
+  {}
+
+  void evict(ImageCacheEntry *e)
+  {
+    idle.remove(e->link);
+    entries.remove(e->key);
+    bytes -= e->byteCount();
+    --entryCount;
+    ++evictions;
+    shState->texPool().release(e->tex);
+    delete e;
+  }
+
+  void trim(uint64_t limit)
+  {
+    while (bytes > limit) {
+      ImageCacheEntry *e = idle.tail();
+      if (!e) break;
+      evict(e);
+    }
+  }
+};
+
+ImageCache::ImageCache(uint64_t budget)
+{
+  p = new ImageCachePrivate(budget);
+}
+
+ImageCache::~ImageCache()
+{// Nothing may use these anymore, the pool is going down as well
+  BoostHash<CacheKey, ImageCacheEntry*>::const_iterator iter;
+  for (iter = p->entries.cbegin(); iter != p->entries.cend(); ++iter) {
+    ImageCacheEntry *e = iter->second;
+    TEXFBO::fini(e->tex);
+    p->idle.remove(e->link);
+    delete e;
+  }
+  delete p;
+}
+
+std::string ImageCache::resolvePath(const char *filename)
+{
+  std::string path = shState->fileSystem().resolvePath(filename);
+  return path.empty() ? std::string(filename) : path;
+}
+
+ImageCacheEntry *ImageCache::acquire(const char *filename, int hue)
+{
+  CacheKey key(resolvePath(filename), hue);
+  ImageCacheEntry *e = p->entries.value(key, 0);
+  if (!e) {
+    ++p->misses;
+    return 0;
+  }
+  ++p->hits;
+  if (e->refCount++ == 0)
+    p->idle.remove(e->link);
+  return e;
+}
+
+ImageCacheEntry *ImageCache::insert(const char *filename, int hue, const TEXFBO &tex)
+{
+  CacheKey key(resolvePath(filename), hue);
+  ImageCacheEntry *old = p->entries.value(key, 0);
+  /* A previous entry with this key might still be in use by
+   * Bitmaps; forget about it, it will be deleted once released */
+  if (old) {
+    p->entries.remove(key);
+    p->bytes -= old->byteCount();
+    --p->entryCount;
+    if (old->refCount == 0) {
+      p->idle.remove(old->link);
+      shState->texPool().release(old->tex);
+      delete old;
+    } else {
+      old->orphaned = true;
+    }
+  }
+  ImageCacheEntry *e = new ImageCacheEntry(key, tex);
+  e->refCount = 1;
+  p->entries.insert(key, e);
+  p->bytes += e->byteCount();
+  ++p->entryCount;
+  p->trim(p->budget);
+  return e;
+}
+
+ImageCacheEntry *ImageCache::retain(ImageCacheEntry *e)
+{
+  assert(e->refCount > 0);
+  ++e->refCount;
+  return e;
+}
+
+void ImageCache::release(ImageCacheEntry *e)
+{
+  assert(e->refCount > 0);
+  if (--e->refCount > 0)
+    return;
+  if (e->orphaned) {
+    shState->texPool().release(e->tex);
+    delete e;
+    return;
+  }
+  p->idle.prepend(e->link);
+  p->trim(p->budget);
+}
+
+const TEXFBO &ImageCache::texture(const ImageCacheEntry *entry)
+{
+  return entry->tex;
+}
+
+void ImageCache::setBudget(uint64_t bytes)
+{
+  p->budget = bytes;
+  p->trim(p->budget);
+}
+
+uint64_t ImageCache::getBudget() const
+{
+  return p->budget;
+}
+
+void ImageCache::clear()
+{
+  p->trim(0);
+}
+
+ImageCache::Stats ImageCache::getStats() const
+{
+  Stats s;
+  s.hits = p->hits;
+  s.misses = p->misses;
+  s.evictions = p->evictions;
+  s.bytes = p->bytes;
+  s.budget = p->budget;
+  s.entries = p->entryCount;
+  s.idleEntries = p->idle.getSize();
+  return s;
+}
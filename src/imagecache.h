@@ -0,0 +1,75 @@
+/*
+** imagecache.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include "gl-util.h"
+#include <stdint.h>
+#include <string>
+
+struct ImageCachePrivate;
+struct ImageCacheEntry;
+/* Keeps decoded image files resident as textures, keyed by
+ * (resolved path, hue). Bitmaps loaded from the same file share
+ * one texture until they draw into it (copy on write). Entries
+ * no Bitmap refers to anymore are kept around until the VRAM
+ * budget is exceeded, then handed back to TexPool in LRU order */
+class ImageCache
+{
+public:
+  struct Stats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t bytes;
+    uint64_t budget;
+    int entries;
+    int idleEntries;
+  };
+
+  ImageCache(uint64_t budget = 64 * 1024 * 1024);
+  ~ImageCache();
+  /* Returns a referenced entry or 0 on a cache miss */
+  ImageCacheEntry *acquire(const char *filename, int hue = 0);
+  /* Takes ownership of 'tex' and returns a referenced entry */
+  ImageCacheEntry *insert(const char *filename, int hue, const TEXFBO &tex);
+  /* Adds a reference to an entry that is already held */
+  ImageCacheEntry *retain(ImageCacheEntry *entry);
+  /* Drops one reference; the texture stays cached while it fits the budget */
+  void release(ImageCacheEntry *entry);
+  static const TEXFBO &texture(const ImageCacheEntry *entry);
+  void setBudget(uint64_t bytes);
+  uint64_t getBudget() const;
+  /* Evicts every entry no Bitmap refers to */
+  void clear();
+  Stats getStats() const;
+  /* Key used for file lookups, the path of the file that
+   * FileSystem resolves the name to, so different files that
+   * only differ in case or extension stay apart */
+  static std::string resolvePath(const char *filename);
+
+private:
+  ImageCachePrivate *p;
+};
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,235 @@
+/*
+** imageloader.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imageloader.h"
+#include <SDL_cpuinfo.h>
+#include <SDL_image.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include "sdl-util.h"
+#include "util.h"
+#include "sharedstate.h"
+#include "filesystem.h"
+#include "exception.h"
+
+#define MAX_WORKERS 4
+
+struct ImageLoadJob
+{
+  std::string filename;
+  SDL_Surface *surf;
+  std::string error;
+  bool done;
+  bool cancelled;
+
+  ImageLoadJob(const char *filename)
+  : filename(filename), surf(0), done(false), cancelled(false)
+  {}
+};
+
+struct DecodeHandler : FileSystem::OpenHandler
+{
+  SDL_Surface *surf;
+  DecodeHandler() : surf(0) {}
+
+  bool tryRead(SDL_RWops &ops, const char *ext)
+  {
+    surf = IMG_LoadTyped_RW(&ops, 1, ext);
+    return surf != 0;
+  }
+};
+
+struct ImageLoaderPrivate
+{
+  SDL_mutex *mutex;
+  // Signaled when a job gets queued or the workers should quit
+  SDL_cond *queued;
+  // Signaled whenever a worker finishes a job
+  SDL_cond *finished;
+  std::deque<ImageLoadJob*> queue;
+  std::vector<SDL_Thread*> workers;
+  bool quit;
+
+  ImageLoaderPrivate() : quit(false)
+  {
+    mutex = SDL_CreateMutex();
+    queued = SDL_CreateCond();
+    finished = SDL_CreateCond();
+  }
+
+  ~ImageLoaderPrivate()
+  {
+    SDL_DestroyCond(finished);
+    SDL_DestroyCond(queued);
+    SDL_DestroyMutex(mutex);
+  }
+
+  void startWorkers()
+  {
+    int count = clamp(SDL_GetCPUCount() - 1, 1, MAX_WORKERS);
+    for (int i = 0; i < count; i++) {
+      SDL_Thread *t = createSDLThread
+        <ImageLoaderPrivate, &ImageLoaderPrivate::workerFun>(this, "imageloader");
+      if (t)
+        workers.push_back(t);
+    }
+  }
+
+  static void decode(ImageLoadJob &job)
+  {
+    DecodeHandler handler;
+    try {
+      shState->fileSystem().openRead(handler, job.filename.c_str());
+    } catch (const Exception &e) {
+      job.error = e.msg;
+      return;
+    }
+    if (!handler.surf) {
+      job.error = std::string("Error loading image '") + job.filename +
+                  "': " + SDL_GetError();
+      return;
+    }
+    SDL_Surface *surf = handler.surf;
+    if (surf->format->format != SDL_PIXELFORMAT_ABGR8888) {
+      SDL_Surface *conv = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ABGR8888, 0);
+      SDL_FreeSurface(surf);
+      surf = conv;
+      if (!surf) {
+        job.error = std::string("Error converting image '") + job.filename +
+                    "': " + SDL_GetError();
+        return;
+      }
+    }
+    job.surf = surf;
+  }
+
+  void workerFun()
+  {
+    SDL_LockMutex(mutex);
+    while (true) {
+      while (queue.empty() && !quit)
+        SDL_CondWait(queued, mutex);
+      if (quit)
+        break;
+      ImageLoadJob *job = queue.front();
+      queue.pop_front();
+      if (job->cancelled) {
+        delete job;
+        continue;
+      }
+      SDL_UnlockMutex(mutex);
+      decode(*job);
+      SDL_LockMutex(mutex);
+      job->done = true;
+      if (job->cancelled) {
+        SDL_FreeSurface(job->surf);
+        delete job;
+      }
+      SDL_CondBroadcast(finished);
+    }
+    SDL_UnlockMutex(mutex);
+  }
+};
+
+ImageLoader::ImageLoader()
+{
+  p = new ImageLoaderPrivate;
+}
+
+ImageLoader::~ImageLoader()
+{
+  SDL_LockMutex(p->mutex);
+  p->quit = true;
+  SDL_CondBroadcast(p->queued);
+  SDL_UnlockMutex(p->mutex);
+  for (size_t i = 0; i < p->workers.size(); i++)
+    SDL_WaitThread(p->workers[i], 0);
+  /* Jobs still owned by Bitmaps are left alone,
+   * the cancelled ones nobody will pick up anymore */
+  for (size_t i = 0; i < p->queue.size(); i++)
+    if (p->queue[i]->cancelled)
+      delete p->queue[i];
+  delete p;
+}
+
+ImageLoadJob *ImageLoader::enqueue(const char *filename)
+{
+  ImageLoadJob *job = new ImageLoadJob(filename);
+  SDL_LockMutex(p->mutex);
+  if (p->workers.empty())
+    p->startWorkers();
+  p->queue.push_back(job);
+  SDL_CondSignal(p->queued);
+  SDL_UnlockMutex(p->mutex);
+  return job;
+}
+
+bool ImageLoader::isDone(ImageLoadJob *job) const
+{
+  SDL_LockMutex(p->mutex);
+  bool done = job->done;
+  SDL_UnlockMutex(p->mutex);
+  return done;
+}
+
+SDL_Surface *ImageLoader::take(ImageLoadJob *job, std::string &error)
+{
+  SDL_LockMutex(p->mutex);
+  std::deque<ImageLoadJob*>::iterator queued =
+    std::find(p->queue.begin(), p->queue.end(), job);
+  if (queued != p->queue.end()) {
+    /* No worker got to it yet, decoding it right here beats
+     * waiting for every job queued ahead of it */
+    p->queue.erase(queued);
+    SDL_UnlockMutex(p->mutex);
+    ImageLoaderPrivate::decode(*job);
+    SDL_LockMutex(p->mutex);
+    job->done = true;
+  }
+  // Otherwise a worker is decoding it already
+  while (!job->done)
+    SDL_CondWait(p->finished, p->mutex);
+  SDL_UnlockMutex(p->mutex);
+  SDL_Surface *surf = job->surf;
+  error = job->error;
+  delete job;
+  return surf;
+}
+
+void ImageLoader::cancel(ImageLoadJob *job)
+{
+  SDL_LockMutex(p->mutex);
+  if (job->done) {
+    SDL_FreeSurface(job->surf);
+    delete job;
+  } else {
+    job->cancelled = true;
+  }
+  SDL_UnlockMutex(p->mutex);
+}
+
+const char *ImageLoader::filename(const ImageLoadJob *job)
+{
+  return job->filename.c_str();
+}
@@ -0,0 +1,56 @@
+/*
+** imageloader.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <string>
+
+struct SDL_Surface;
+struct ImageLoaderPrivate;
+struct ImageLoadJob;
+/* Decodes image files on a small pool of worker threads.
+ * Workers only read the file and convert it into the pixel
+ * format Bitmaps use; uploading to GL stays on the thread
+ * owning the context, see Bitmap::loadAsync */
+class ImageLoader
+{
+public:
+  ImageLoader();
+  ~ImageLoader();
+  /* Queues 'filename' for decoding; the worker threads
+   * get started the first time this is called */
+  ImageLoadJob *enqueue(const char *filename);
+  bool isDone(ImageLoadJob *job) const;
+  /* Hands over the surface of 'job' and frees the job, decoding
+   * it on the calling thread if no worker has picked it up yet,
+   * or waiting for the one that did. Returns 0 on failure with
+   * the reason in 'error' */
+  SDL_Surface *take(ImageLoadJob *job, std::string &error);
+  /* Gives up on a job, its result gets freed by the worker */
+  void cancel(ImageLoadJob *job);
+  static const char *filename(const ImageLoadJob *job);
+
+private:
+  ImageLoaderPrivate *p;
+};
+
+#endif // IMAGELOADER_H
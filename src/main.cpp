@@ -100,7 +100,10 @@ int rgssThreadFun(void *userdata)
   gl.Clear(GL_COLOR_BUFFER_BIT);
   SDL_GL_SwapWindow(win);
   printGLInfo();
-  bool vsync = conf.vsync || conf.syncToRefreshrate;
+  /* There's no display to sync to when running headless,
+   * and benchmarks must not wait for one */
+  bool vsync = !conf.headless && !conf.benchmark &&
+               (conf.vsync || conf.syncToRefreshrate);
   SDL_GL_SetSwapInterval(vsync ? 1 : 0);
   GLDebugLogger dLogger;
   // Setup AL context
@@ -140,9 +143,14 @@ static void printHCVersion()
   Debug() << "Release Date:               " << HIDDENDATE;
 }
 
+// Headless runs only log errors, no one would be there to close a dialog
+static bool showDialogs = true;
+
 static void showInitError(const std::string &msg)
 {
   Debug() << msg;
+  if (!showDialogs)
+    return;
   SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "HiddenChest", msg.c_str(), 0);
 }
 
@@ -164,6 +172,17 @@ int main(int argc, char *argv[])
 {
   SDL_SetHint(SDL_HINT_VIDEO_MINIMIZE_ON_FOCUS_LOSS, "0");
   SDL_SetHint(SDL_HINT_ACCELEROMETER_AS_JOYSTICK, "0");
+  // now we partially load the config, it doesn't touch any file yet
+  Config conf;
+  conf.read(argc, argv);
+  showDialogs = !conf.headless;
+  if (conf.headless) {
+    /* SDL's offscreen driver renders into EGL pbuffers, so Mesa's
+     * llvmpipe is enough and no display server is needed */
+    SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+    // OpenAL Soft's null backend accepts and discards all output
+    SDL_setenv("ALSOFT_DRIVERS", "null", 1);
+  }
   // initialize SDL first
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0) {
     showInitError(std::string("Error initializing SDL: ") + SDL_GetError());
@@ -182,9 +201,6 @@ int main(int argc, char *argv[])
     SDL_free(dataDir);
   }
 #endif
-  // now we partially load the config
-  Config conf;
-  conf.read(argc, argv);
   if (!conf.gameFolder.empty()) {
     if (chdir(conf.gameFolder.c_str()) != 0) {
       showInitError(std::string("Unable to switch into gameFolder ") + conf.gameFolder);
@@ -233,7 +249,9 @@ int main(int argc, char *argv[])
   Uint32 winFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_INPUT_FOCUS;
   if (conf.winResizable)
     winFlags |= SDL_WINDOW_RESIZABLE;
-  if ((START_WIDTH == scr.w && START_HEIGHT == scr.h) || conf.fullscreen)
+  if (conf.headless)
+    winFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN;
+  else if ((START_WIDTH == scr.w && START_HEIGHT == scr.h) || conf.fullscreen)
     winFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
   winFlags |= SDL_WINDOW_BORDERLESS;
   win = SDL_CreateWindow("",
@@ -279,13 +297,14 @@ int main(int argc, char *argv[])
   //otherwise abandon hope and just end the process as is.
   if (rtData.rqTermAck)
     SDL_WaitThread(rgssThread, 0);
-  else
+  else if (showDialogs)
     SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, conf.windowTitle.c_str(),
       "The RGSS script seems to be stuck and HiddenChest will now force quit", win);
   if (!rtData.rgssErrorMsg.empty()) {
     Debug() << rtData.rgssErrorMsg;
-    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, conf.windowTitle.c_str(),
-                             rtData.rgssErrorMsg.c_str(), win);
+    if (showDialogs)
+      SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, conf.windowTitle.c_str(),
+                               rtData.rgssErrorMsg.c_str(), win);
   } // Clean up any remaining events
   eventThread.cleanup();
   Debug() << "Shutting down.";
@@ -295,5 +314,6 @@ int main(int argc, char *argv[])
   TTF_Quit();
   IMG_Quit();
   SDL_Quit();
-  return 0;
+  // Lets automated runs tell a crashed game from a finished one
+  return conf.headless && !rtData.rgssErrorMsg.empty() ? 1 : 0;
 }
@@ -300,30 +300,35 @@ Tone& MsgBoxSprite::getTone() const
 void MsgBoxSprite::setOpacity(int opacity)
 {
   guardDisposed();
+  Scene::markChanged();
   p->opacity = opacity;
 }
 
 void MsgBoxSprite::setSrcRect(Rect &rect)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->srcRect = rect;
 }
 
 void MsgBoxSprite::setColor(Color &color)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->color = color;
 }
 
 void MsgBoxSprite::setColor(double r, double g, double b, double a)
 {
   guardDisposed();
+  Scene::markChanged();
   p->color->set(r, g, b, a);
 }
 
 void MsgBoxSprite::setTone(Tone &tone)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->tone = tone;
 }
 
@@ -331,6 +336,7 @@ void MsgBoxSprite::setBitmap(Bitmap *bitmap)
 {
   guardDisposed();
   if (p->bitmap == bitmap) return;
+  Scene::markChanged();
   p->bitmap = bitmap;
   if (nullOrDisposed(bitmap)) return;
   bitmap->ensureNonMega();
@@ -343,6 +349,7 @@ void MsgBoxSprite::setContents(Bitmap *bitmap)
 {
   guardDisposed();
   if (p->bitmap == bitmap) return;
+  Scene::markChanged();
   p->contents = bitmap;
   if (nullOrDisposed(bitmap)) return;
   bitmap->ensureNonMega();
@@ -353,6 +360,7 @@ void MsgBoxSprite::setBarBitmap(Bitmap *bitmap)
 {
   guardDisposed();
   if (nullOrDisposed(bitmap)) return;
+  Scene::markChanged();
   p->bar_bitmap = bitmap;
   if (p->bar_bitmap == bitmap) return;
   bitmap->ensureNonMega();
@@ -363,6 +371,7 @@ void MsgBoxSprite::setCloseIcon(Bitmap *bitmap)
 {
   guardDisposed();
   if (nullOrDisposed(bitmap)) return;
+  Scene::markChanged();
   p->close_icon = bitmap;
   if (p->close_icon == bitmap) return;
   bitmap->ensureNonMega();
@@ -373,6 +382,7 @@ void MsgBoxSprite::setX(int value)
 {
   guardDisposed();
   if (p->trans.getPosition().x == value) return;
+  Scene::markChanged();
   p->trans.setPosition(Vec2(value, getY()));
 }
 
@@ -380,6 +390,7 @@ void MsgBoxSprite::setY(int value)
 {
   guardDisposed();
   if (p->trans.getPosition().y == value) return;
+  Scene::markChanged();
   p->trans.setPosition(Vec2(getX(), value));
 }
 
@@ -387,6 +398,7 @@ void MsgBoxSprite::setOX(int value)
 {
   guardDisposed();
   if (p->trans.getOrigin().x == value) return;
+  Scene::markChanged();
   p->trans.setOrigin(Vec2(value, getOY()));
 }
 
@@ -394,6 +406,7 @@ void MsgBoxSprite::setOY(int value)
 {
   guardDisposed();
   if (p->trans.getOrigin().y == value) return;
+  Scene::markChanged();
   p->trans.setOrigin(Vec2(getOX(), value));
 }
 
@@ -401,6 +414,7 @@ void MsgBoxSprite::setZoomX(float value)
 {
   guardDisposed();
   if (p->trans.getScale().x == value) return;
+  Scene::markChanged();
   p->trans.setScale(Vec2(value, getZoomY()));
 }
 
@@ -408,6 +422,7 @@ void MsgBoxSprite::setZoomY(float value)
 {
   guardDisposed();
   if (p->trans.getScale().y == value) return;
+  Scene::markChanged();
   p->trans.setScale(Vec2(getZoomX(), value));
 }
 
@@ -415,6 +430,7 @@ void MsgBoxSprite::setAngle(float value)
 {
   guardDisposed();
   if (p->trans.getRotation() == value) return;
+  Scene::markChanged();
   p->trans.setRotation(value);
 }
 
@@ -422,6 +438,7 @@ void MsgBoxSprite::setMirror(bool mirrored)
 {
   guardDisposed();
   if (p->mirrored == mirrored) return;
+  Scene::markChanged();
   p->mirrored = mirrored;
   p->onSrcRectChange();
 }
@@ -430,6 +447,7 @@ void MsgBoxSprite::setMirrorY(bool mirrored)
 {
   guardDisposed();
   if (p->mirroredY == mirrored) return;
+  Scene::markChanged();
   p->mirroredY = mirrored;
   p->onSrcRectChange();
 }
@@ -437,6 +455,7 @@ void MsgBoxSprite::setMirrorY(bool mirrored)
 void MsgBoxSprite::setBlendType(int type)
 {
   guardDisposed();
+  Scene::markChanged();
   switch (type) {
   default :
   case BlendNormal :
@@ -466,6 +485,7 @@ void MsgBoxSprite::setReduceSpeed(int speed)
 void MsgBoxSprite::increaseWidth()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reducedWidth = p->bitmap->width();
   p->increaseWidth = true;
   p->updateReduceWidth();
@@ -474,6 +494,7 @@ void MsgBoxSprite::increaseWidth()
 void MsgBoxSprite::increaseHeight()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reducedHeight = p->bitmap->height();
   p->increaseHeight = true;
   p->updateReduceHeight();
@@ -482,6 +503,7 @@ void MsgBoxSprite::increaseHeight()
 void MsgBoxSprite::increaseWidthHeight()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reducedWidth = p->bitmap->width();
   p->reducedHeight = p->bitmap->height();
   p->increaseWidth = true;
@@ -493,18 +515,21 @@ void MsgBoxSprite::increaseWidthHeight()
 void MsgBoxSprite::reduceWidth()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduceWidth = true;
 }
 
 void MsgBoxSprite::reduceHeight()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduceHeight = true;
 }
 
 void MsgBoxSprite::reduceWidthHeight()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduceWidth = true;
   p->reduceHeight = true;
 }
@@ -588,6 +613,8 @@ void MsgBoxSprite::initDynAttribs()
 void MsgBoxSprite::update()
 {
   guardDisposed();
+  if (p->increaseWidth || p->reduceWidth || p->increaseHeight || p->reduceHeight)
+    Scene::markChanged();
   p->updateReduceWidth();
   p->updateReduceHeight();
 }
@@ -90,6 +90,7 @@ private:
   AlphaSpriteShader* makeAlphaShader(AlphaSpriteShader&);
   SimpleSpriteShader* makeSimpleShader(SimpleSpriteShader&);
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawSprite; }
   void releaseResources();
   const char *klassName() const { return "MsgBoxSprite"; }
   ABOUT_TO_ACCESS_DISP
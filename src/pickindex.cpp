@@ -0,0 +1,143 @@
+/*
+** pickindex.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pickindex.h"
+#include "scene.h"
+#include <algorithm>
+
+// Side length of a grid cell in pixels
+#define PICK_CELL 64
+
+bool PickIndex::drawnBelow(const PickEntry &a, const PickEntry &b)
+{ // Viewports are sorted among the screen's elements first,
+  // their children only among each other
+  if (a.root != b.root)
+    return *a.root < *b.root;
+  return *a.element < *b.element;
+}
+
+PickIndex::PickIndex(int width, int height)
+: width(0), height(0), cols(0), rows(0)
+{
+  resize(width, height);
+}
+
+void PickIndex::resize(int width, int height)
+{
+  for (size_t i = 0; i < cells.size(); i++)
+    cells[i].clear();
+  this->width = width;
+  this->height = height;
+  cols = (width + PICK_CELL - 1) / PICK_CELL;
+  rows = (height + PICK_CELL - 1) / PICK_CELL;
+  cells.resize(cols * rows);
+  for (size_t i = 0; i < entries.size(); i++)
+    link(*entries[i]);
+}
+
+void PickIndex::cellRange(const IntRect &rect, int &x1, int &y1, int &x2, int &y2) const
+{ // Inclusive range of cells touched by 'rect', clipped to the screen
+  x1 = std::max(rect.x, 0) / PICK_CELL;
+  y1 = std::max(rect.y, 0) / PICK_CELL;
+  x2 = (std::min(rect.x + rect.w, width) - 1) / PICK_CELL;
+  y2 = (std::min(rect.y + rect.h, height) - 1) / PICK_CELL;
+}
+
+void PickIndex::link(PickEntry &entry)
+{
+  const IntRect &r = entry.rect;
+  if (r.x >= width || r.y >= height || r.x + r.w <= 0 || r.y + r.h <= 0)
+    return;
+  int x1, y1, x2, y2;
+  cellRange(r, x1, y1, x2, y2);
+  for (int y = y1; y <= y2; y++)
+    for (int x = x1; x <= x2; x++)
+      cells[y * cols + x].push_back(&entry);
+}
+
+void PickIndex::unlink(PickEntry &entry)
+{
+  const IntRect &r = entry.rect;
+  if (r.x >= width || r.y >= height || r.x + r.w <= 0 || r.y + r.h <= 0)
+    return;
+  int x1, y1, x2, y2;
+  cellRange(r, x1, y1, x2, y2);
+  for (int y = y1; y <= y2; y++) {
+    for (int x = x1; x <= x2; x++) {
+      std::vector<PickEntry*> &cell = cells[y * cols + x];
+      std::vector<PickEntry*>::iterator it = std::find(cell.begin(), cell.end(), &entry);
+      if (it == cell.end())
+        continue;
+      *it = cell.back();
+      cell.pop_back();
+    }
+  }
+}
+
+void PickIndex::update(PickEntry &entry, const IntRect &rect)
+{
+  if (rect.w <= 0 || rect.h <= 0) {
+    remove(entry);
+    return;
+  }
+  if (entry.slot >= 0) {
+    // Most elements stand still, so this is the common case
+    if (entry.rect == rect)
+      return;
+    unlink(entry);
+  } else {
+    entry.slot = entries.size();
+    entries.push_back(&entry);
+  }
+  entry.rect = rect;
+  link(entry);
+}
+
+void PickIndex::remove(PickEntry &entry)
+{
+  if (entry.slot < 0)
+    return;
+  unlink(entry);
+  PickEntry *last = entries.back();
+  entries[entry.slot] = last;
+  last->slot = entry.slot;
+  entries.pop_back();
+  entry.slot = -1;
+}
+
+PickEntry *PickIndex::pick(int x, int y) const
+{
+  if (x < 0 || y < 0 || x >= width || y >= height)
+    return 0;
+  const std::vector<PickEntry*> &cell = cells[(y / PICK_CELL) * cols + x / PICK_CELL];
+  PickEntry *top = 0;
+  for (size_t i = 0; i < cell.size(); i++) {
+    PickEntry *e = cell[i];
+    const IntRect &r = e->rect;
+    if (x < r.x || y < r.y || x >= r.x + r.w || y >= r.y + r.h)
+      continue;
+    if (!e->element->visible || !e->root->visible)
+      continue;
+    if (!top || drawnBelow(*top, *e))
+      top = e;
+  }
+  return top;
+}
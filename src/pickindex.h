@@ -0,0 +1,76 @@
+/*
+** pickindex.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PICKINDEX_H
+#define PICKINDEX_H
+
+#include "etc-internal.h"
+#include <vector>
+
+class SceneElement;
+/* A pickable element as known to the index. Its owner keeps
+ * 'rect' up to date through PickIndex::update() whenever it
+ * recomputes its screen geometry */
+struct PickEntry
+{
+  // Element whose draw order decides which hit is on top
+  SceneElement *element;
+  // Element placed on the screen: its viewport, or itself
+  SceneElement *root;
+  // Handed back by PickIndex::pick(), ie. the wrapping Ruby object
+  void *data;
+  // Screen space bounding box
+  IntRect rect;
+  // Position in the index' entry list, -1 while not indexed
+  int slot;
+
+  PickEntry(SceneElement *element)
+  : element(element), root(element), data(0), slot(-1)
+  {}
+};
+
+/* Uniform grid over the screen mapping points to the elements
+ * covering them, so a click can be resolved without testing
+ * every sprite and window from script */
+class PickIndex
+{
+public:
+  PickIndex(int width, int height);
+  // Rebuilds the grid for a new screen resolution
+  void resize(int width, int height);
+  // An empty 'rect' takes the entry out of the index
+  void update(PickEntry &entry, const IntRect &rect);
+  void remove(PickEntry &entry);
+  // Topmost visible entry covering (x, y), 0 if there's none
+  PickEntry *pick(int x, int y) const;
+
+private:
+  void cellRange(const IntRect &rect, int &x1, int &y1, int &x2, int &y2) const;
+  static bool drawnBelow(const PickEntry &a, const PickEntry &b);
+  void link(PickEntry &entry);
+  void unlink(PickEntry &entry);
+  int width, height;
+  int cols, rows;
+  std::vector<std::vector<PickEntry*> > cells;
+  std::vector<PickEntry*> entries;
+};
+
+#endif // PICKINDEX_H
@@ -130,7 +130,7 @@ DEF_ATTR_RD_SIMPLE(Plane, OY,        int,     p->oy)
 DEF_ATTR_RD_SIMPLE(Plane, ZoomX,     float,   p->zoomX)
 DEF_ATTR_RD_SIMPLE(Plane, ZoomY,     float,   p->zoomY)
 DEF_ATTR_RD_SIMPLE(Plane, BlendType, int,     p->blendType)
-DEF_ATTR_SIMPLE(Plane, Opacity,   int,     p->opacity)
+DEF_ATTR_RD_SIMPLE(Plane, Opacity,   int,     p->opacity)
 DEF_ATTR_SIMPLE(Plane, Color,     Color&, *p->color)
 DEF_ATTR_SIMPLE(Plane, Tone,      Tone&,  *p->tone)
 
@@ -139,9 +139,18 @@ Plane::~Plane()
   dispose();
 }
 
+void Plane::setOpacity(int value)
+{
+  guardDisposed();
+  if (p->opacity == value) return;
+  Scene::markChanged();
+  p->opacity = value;
+}
+
 void Plane::setBitmap(Bitmap *value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->bitmap = value;
   if (!value) return;
   value->ensureNonMega();
@@ -151,6 +160,7 @@ void Plane::setOX(int value)
 {
   guardDisposed();
   if (p->ox == value) return;
+  Scene::markChanged();
   p->ox = value;
   p->quadSourceDirty = true;
 }
@@ -159,6 +169,7 @@ void Plane::setOY(int value)
 {
   guardDisposed();
   if (p->oy == value) return;
+  Scene::markChanged();
   p->oy = value;
   p->quadSourceDirty = true;
 }
@@ -167,6 +178,7 @@ void Plane::setZoomX(float value)
 {
   guardDisposed();
   if (p->zoomX == value) return;
+  Scene::markChanged();
   p->zoomX = value;
   p->quadSourceDirty = true;
 }
@@ -175,6 +187,7 @@ void Plane::setZoomY(float value)
 {
   guardDisposed();
   if (p->zoomY == value) return;
+  Scene::markChanged();
   p->zoomY = value;
   p->quadSourceDirty = true;
 }
@@ -182,6 +195,7 @@ void Plane::setZoomY(float value)
 void Plane::setBlendType(int value)
 {
   guardDisposed();
+  Scene::markChanged();
   switch (value)
   {
   default :
@@ -52,6 +52,7 @@ public:
 private:
 	PlanePrivate *p;
 	void draw();
+	FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawPlane; }
 	void onGeometryChange(const Scene::Geometry &);
 	void releaseResources();
 	const char *klassName() const { return "plane"; }
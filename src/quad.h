@@ -127,6 +127,7 @@ struct Quad
       vboDirty = false;
     }
     GLMeta::vaoBind(vao);
+    ++GLState::counters.draws;
     gl.DrawElements(GL_TRIANGLES, 6, _GL_INDEX_TYPE, 0);
     GLMeta::vaoUnbind(vao);
   }
@@ -138,6 +139,7 @@ struct Quad
       vboDirty = false;
     }
     GLMeta::vaoBind(vao);
+    ++GLState::counters.draws;
     gl.DrawElements(GL_TRIANGLES, 3, _GL_INDEX_TYPE, 0);
     GLMeta::vaoUnbind(vao);
   }
@@ -87,6 +87,7 @@ struct QuadArray
   {
     GLMeta::vaoBind(vao);
     const char *_offset = (const char*) 0 + offset * 6 * sizeof(index_t);
+    ++GLState::counters.draws;
     gl.DrawElements(GL_TRIANGLES, count * 6, _GL_INDEX_TYPE, _offset);
     GLMeta::vaoUnbind(vao);
   }
@@ -104,5 +105,6 @@ struct QuadArray
 
 typedef QuadArray<Vertex> ColorQuadArray;
 typedef QuadArray<SVertex> SimpleQuadArray;
+typedef QuadArray<ShapeVertex> ShapeQuadArray;
 
 #endif // QUADARRAY_H
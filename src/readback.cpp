@@ -0,0 +1,269 @@
+/*
+** readback.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "readback.h"
+#include <SDL_image.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+#include <string.h>
+#include <deque>
+#include <algorithm>
+#include "gl-fun.h"
+#include "gl-util.h"
+#include "boost-hash.h"
+#include "sdl-util.h"
+#include "debugwriter.h"
+
+/* Number of poll() calls a pack buffer is left alone before
+ * it's mapped, so the driver had time to finish the copy */
+#define READBACK_DELAY 2
+/* Finished tickets nobody asked about are kept around this
+ * long for late status() calls, older ones get forgotten */
+#define READBACK_KEEP 64
+
+struct Readback
+{
+  int ticket;
+  PackBO::ID bo;
+  // Only used without pack buffer support, filled right away
+  SDL_Surface *surf;
+  int width, height;
+  int age;
+};
+
+struct EncodeJob
+{
+  int ticket;
+  SDL_Surface *surf;
+};
+
+struct TicketInfo
+{
+  ReadbackQueue::Status status;
+  std::string path;
+  bool jpg;
+};
+
+struct ReadbackQueuePrivate
+{
+  // Only touched from the thread owning the GL context
+  std::vector<Readback> inFlight;
+  int nextTicket;
+  // Everything below is shared with the encoder thread
+  SDL_mutex *mutex;
+  SDL_cond *queued;
+  std::deque<EncodeJob> jobs;
+  BoostHash<int, TicketInfo> tickets;
+  std::vector<int> finished;
+  // Every finished ticket still in 'tickets', oldest first
+  std::deque<int> kept;
+  SDL_Thread *encoder;
+  bool quit;
+
+  ReadbackQueuePrivate() : nextTicket(1), encoder(0), quit(false)
+  {
+    mutex = SDL_CreateMutex();
+    queued = SDL_CreateCond();
+  }
+
+  ~ReadbackQueuePrivate()
+  {
+    SDL_DestroyCond(queued);
+    SDL_DestroyMutex(mutex);
+  }
+
+  static SDL_Surface *createSurface(int width, int height)
+  {
+    int bpp;
+    Uint32 rMask, gMask, bMask, aMask;
+    SDL_PixelFormatEnumToMasks(SDL_PIXELFORMAT_ABGR8888,
+                               &bpp, &rMask, &gMask, &bMask, &aMask);
+    return SDL_CreateRGBSurface(0, width, height, bpp, rMask, gMask, bMask, aMask);
+  }
+
+  SDL_Surface *mapReadback(Readback &rb)
+  {
+    if (rb.surf)
+      return rb.surf;
+    SDL_Surface *surf = createSurface(rb.width, rb.height);
+    size_t bytes = (size_t) rb.width * rb.height * 4;
+    PackBO::bind(rb.bo);
+    void *src = gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (src && surf) {
+      memcpy(surf->pixels, src, bytes);
+    } else {
+      SDL_FreeSurface(surf);
+      surf = 0;
+    }
+    if (src)
+      gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    PackBO::unbind();
+    PackBO::del(rb.bo);
+    return surf;
+  }
+
+  void finish(int ticket, bool saved)
+  {
+    TicketInfo &info = tickets[ticket];
+    info.status = saved ? ReadbackQueue::Saved : ReadbackQueue::Failed;
+    finished.push_back(ticket);
+    kept.push_back(ticket);
+    if (kept.size() > READBACK_KEEP) {
+      tickets.remove(kept.front());
+      kept.pop_front();
+    }
+  }
+
+  void encoderFun()
+  {
+    SDL_LockMutex(mutex);
+    while (true) {
+      while (jobs.empty() && !quit)
+        SDL_CondWait(queued, mutex);
+      // Whatever got queued is still written out before quitting
+      if (jobs.empty())
+        break;
+      EncodeJob job = jobs.front();
+      jobs.pop_front();
+      TicketInfo info = tickets[job.ticket];
+      SDL_UnlockMutex(mutex);
+      int result;
+      if (info.jpg)
+        result = IMG_SaveJPG(job.surf, info.path.c_str(), 95);
+      else
+        result = IMG_SavePNG(job.surf, info.path.c_str());
+      if (result != 0)
+        Debug() << "Failed to save" << info.path << ":" << SDL_GetError();
+      SDL_FreeSurface(job.surf);
+      SDL_LockMutex(mutex);
+      finish(job.ticket, result == 0);
+    }
+    SDL_UnlockMutex(mutex);
+  }
+};
+
+ReadbackQueue::ReadbackQueue()
+{
+  p = new ReadbackQueuePrivate;
+}
+
+ReadbackQueue::~ReadbackQueue()
+{
+  poll(true);
+  SDL_LockMutex(p->mutex);
+  p->quit = true;
+  SDL_CondSignal(p->queued);
+  SDL_UnlockMutex(p->mutex);
+  if (p->encoder)
+    SDL_WaitThread(p->encoder, 0);
+  delete p;
+}
+
+int ReadbackQueue::request(TEXFBO &source, const std::string &path, bool jpg)
+{
+  Readback rb;
+  rb.ticket = p->nextTicket++;
+  rb.surf = 0;
+  rb.width = source.width;
+  rb.height = source.height;
+  rb.age = 0;
+  FBO::bind(source.fbo);
+  if (gl.MapBufferRange) {
+    // Returns immediately, the copy happens whenever the GPU gets to it
+    rb.bo = PackBO::gen();
+    PackBO::bind(rb.bo);
+    PackBO::allocEmpty((GLsizeiptr) rb.width * rb.height * 4, GL_STREAM_READ);
+    gl.ReadPixels(0, 0, rb.width, rb.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    PackBO::unbind();
+  } else {
+    rb.surf = ReadbackQueuePrivate::createSurface(rb.width, rb.height);
+    if (rb.surf)
+      gl.ReadPixels(0, 0, rb.width, rb.height, GL_RGBA, GL_UNSIGNED_BYTE, rb.surf->pixels);
+  }
+  TicketInfo info = { Pending, path, jpg };
+  SDL_LockMutex(p->mutex);
+  p->tickets.insert(rb.ticket, info);
+  SDL_UnlockMutex(p->mutex);
+  p->inFlight.push_back(rb);
+  return rb.ticket;
+}
+
+void ReadbackQueue::poll(bool flush)
+{
+  for (size_t i = 0; i < p->inFlight.size();) {
+    Readback &rb = p->inFlight[i];
+    if (!flush && ++rb.age < READBACK_DELAY) {
+      ++i;
+      continue;
+    }
+    SDL_Surface *surf = p->mapReadback(rb);
+    SDL_LockMutex(p->mutex);
+    if (!surf) {
+      p->finish(rb.ticket, false);
+    } else {
+      EncodeJob job = { rb.ticket, surf };
+      p->jobs.push_back(job);
+      if (!p->encoder)
+        p->encoder = createSDLThread
+          <ReadbackQueuePrivate, &ReadbackQueuePrivate::encoderFun>(p, "readback");
+      SDL_CondSignal(p->queued);
+    }
+    SDL_UnlockMutex(p->mutex);
+    p->inFlight.erase(p->inFlight.begin() + i);
+  }
+}
+
+ReadbackQueue::Status ReadbackQueue::status(int ticket) const
+{
+  SDL_LockMutex(p->mutex);
+  const TicketInfo *info = p->tickets.find(ticket);
+  Status st = info ? info->status : Unknown;
+  SDL_UnlockMutex(p->mutex);
+  return st;
+}
+
+std::string ReadbackQueue::path(int ticket) const
+{
+  SDL_LockMutex(p->mutex);
+  const TicketInfo *info = p->tickets.find(ticket);
+  std::string result = info ? info->path : std::string();
+  SDL_UnlockMutex(p->mutex);
+  return result;
+}
+
+void ReadbackQueue::forget(int ticket)
+{
+  SDL_LockMutex(p->mutex);
+  const TicketInfo *info = p->tickets.find(ticket);
+  if (info && info->status != Pending) {
+    p->tickets.remove(ticket);
+    p->kept.erase(std::find(p->kept.begin(), p->kept.end(), ticket));
+  }
+  SDL_UnlockMutex(p->mutex);
+}
+
+void ReadbackQueue::takeFinished(std::vector<int> &out)
+{
+  SDL_LockMutex(p->mutex);
+  out.insert(out.end(), p->finished.begin(), p->finished.end());
+  p->finished.clear();
+  SDL_UnlockMutex(p->mutex);
+}
@@ -0,0 +1,65 @@
+/*
+** readback.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <string>
+#include <vector>
+
+struct TEXFBO;
+struct ReadbackQueuePrivate;
+/* Saves textures to image files without stalling the caller.
+ * glReadPixels goes into a pixel pack buffer that only gets
+ * mapped a couple of frames later, once the GPU is done with
+ * it, and the JPG/PNG encoding runs on a worker thread */
+class ReadbackQueue
+{
+public:
+  enum Status
+  {
+    // Never handed out, or forgotten since
+    Unknown = -2,
+    Failed = -1,
+    Pending = 0,
+    Saved = 1
+  };
+
+  ReadbackQueue();
+  ~ReadbackQueue();
+  // Queues reading back 'source' and returns a ticket to check on it
+  int request(TEXFBO &source, const std::string &path, bool jpg);
+  /* Call once per frame. Readbacks old enough are mapped and handed
+   * to the encoder, 'flush' maps all of them right away */
+  void poll(bool flush = false);
+  Status status(int ticket) const;
+  std::string path(int ticket) const;
+  // Moves the tickets that finished since the last call into 'out'
+  void takeFinished(std::vector<int> &out);
+  /* Drops a finished ticket once its result was reported,
+   * status() reports Unknown for it afterwards */
+  void forget(int ticket);
+
+private:
+  ReadbackQueuePrivate *p;
+};
+
+#endif // READBACK_H
@@ -22,6 +22,8 @@
 #include "scene.h"
 #include "sharedstate.h"
 
+unsigned int Scene::changeEpoch = 0;
+
 Scene::Scene()
 {}
 
@@ -39,10 +41,12 @@ void Scene::insert(SceneElement &element)
     SceneElement *e = iter->data;
     if (element < *e) {
       elements.insertBefore(element.link, *iter);
+      markChanged();
       return;
     }
   }
   elements.append(element.link);
+  markChanged();
 }
 
 void Scene::insertAfter(SceneElement &element, SceneElement &after)
@@ -52,10 +56,12 @@ void Scene::insertAfter(SceneElement &element, SceneElement &after)
     SceneElement *e = iter->data;
     if (element < *e) {
       elements.insertBefore(element.link, *iter);
+      markChanged();
       return;
     }
   }
   elements.append(element.link);
+  markChanged();
 }
 
 void Scene::reinsert(SceneElement &element)
@@ -66,6 +72,7 @@ void Scene::reinsert(SceneElement &element)
 
 void Scene::notifyGeometryChange()
 {
+  markChanged();
   IntruListLink<SceneElement> *iter;
   for (iter = elements.begin(); iter != elements.end(); iter = iter->next)
     iter->data->onGeometryChange(geometry);
@@ -80,6 +87,33 @@ void Scene::composite()
   }
 }
 
+void Scene::compositeProfiled()
+{
+  if (!FrameProfiler::enabled()) {
+    Scene::composite();
+    return;
+  }
+  FrameProfiler::Phase phase = FrameProfiler::DrawOther;
+  uint64_t start = 0;
+  IntruListLink<SceneElement> *iter;
+  for (iter = elements.begin(); iter != elements.end(); iter = iter->next) {
+    SceneElement *e = iter->data;
+    if (!e->visible)
+      continue;
+    FrameProfiler::Phase next = e->profilePhase();
+    if (!start || next != phase) {
+      uint64_t now = SDL_GetPerformanceCounter();
+      if (start)
+        FrameProfiler::record(phase, start, now);
+      phase = next;
+      start = now;
+    }
+    e->draw();
+  }
+  if (start)
+    FrameProfiler::record(phase, start, SDL_GetPerformanceCounter());
+}
+
 
 SceneElement::SceneElement(Scene &scene, int z, int spriteY)
 : link(this),
@@ -128,7 +162,9 @@ bool SceneElement::getVisible() const
 void SceneElement::setVisible(bool value)
 {
   aboutToAccess();
+  if (visible == value) return;
   visible = value;
+  Scene::markChanged();
 }
 
 bool SceneElement::operator<(const SceneElement &o) const
@@ -158,5 +194,7 @@ void SceneElement::setSpriteY(int value)
 
 void SceneElement::unlink()
 {
-  if (scene) scene->elements.remove(link);
+  if (!scene) return;
+  scene->elements.remove(link);
+  Scene::markChanged();
 }
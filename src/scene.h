@@ -26,6 +26,7 @@
 #include "intrulist.h"
 #include "etc.h"
 #include "etc-internal.h"
+#include "frameprofiler.h"
 
 class SceneElement;
 class Viewport;
@@ -56,18 +57,29 @@ public:
                                      const Vec4& /* flash */,
                                      const Vec4& /* tone */) {}
   const Geometry &getGeometry() const { return geometry; }
+  /* Anything changing what ends up on screen bumps the epoch,
+   * so Graphics can skip compositing frames identical to the
+   * last one it presented */
+  static void markChanged() { ++changeEpoch; }
+  static unsigned int epoch() { return changeEpoch; }
 
 protected:
   void insert(SceneElement &element);
   void insertAfter(SceneElement &element, SceneElement &after);
   void reinsert(SceneElement &element);
   void notifyGeometryChange();
+  /* Plain Scene::composite that also times every run of
+   * elements of the same kind while profiling */
+  void compositeProfiled();
   IntruList<SceneElement> elements;
   Geometry geometry;
   friend class SceneElement;
   friend class Window;
   friend class WindowVX;
   friend struct ZLayer;
+
+private:
+  static unsigned int changeEpoch;
 };
 
 class SceneElement
@@ -100,6 +112,11 @@ protected:
    * will fire immediately before each frame draw.
    */
   virtual void draw() = 0;
+  // Where time spent drawing this at the top level is counted
+  virtual FrameProfiler::Phase profilePhase() const
+  {
+    return FrameProfiler::DrawOther;
+  }
   // FIXME: This should be a signal
   virtual void onGeometryChange(const Scene::Geometry &) {}
   /* Compares two elements in terms of their display priority;
@@ -114,6 +131,7 @@ protected:
   Scene *scene;
   friend class Scene;
   friend class Viewport;
+  friend class PickIndex;
   friend struct TilemapPrivate;
 
 private:
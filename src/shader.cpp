@@ -23,6 +23,7 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "exception.h"
+#include "shadercache.h"
 #include <assert.h>
 #include <string.h>
 #include <iostream>
@@ -38,26 +39,21 @@
 #include "grayscale.frag.xxd"
 #include "alpha_mask.frag.xxd"
 #include "color_mask.frag.xxd"
-#include "basic_color.frag.xxd"
 #include "sepia.frag.xxd"
 #include "gradient.frag.xxd"
-#include "gradient_map.frag.xxd"
 #include "gradient_sprite.frag.xxd"
 #include "thermal.frag.xxd"
-#include "vignette.frag.xxd"
-#include "vignette_gray.frag.xxd"
-#include "vignette_sepia.frag.xxd"
-#include "vignette_red.frag.xxd"
-#include "vignette_green.frag.xxd"
-#include "vignette_blue.frag.xxd"
-#include "vignette_yellow.frag.xxd"
-#include "vignette_black.frag.xxd"
+#include "filter_chain.frag.xxd"
+#include "hitmask.frag.xxd"
+#include "snapshot.frag.xxd"
 #include "rounded_rect.frag.xxd"
 #include "circle.frag.xxd"
 #include "triangle.frag.xxd"
 #include "polygon.frag.xxd"
+#include "shape.frag.xxd"
 #include "obscured.frag.xxd"
 #include "flatColor.frag.xxd"
+#include "viewportEffect.frag.xxd"
 #include "simple.frag.xxd"
 #include "simpleColor.frag.xxd"
 #include "simpleAlpha.frag.xxd"
@@ -67,9 +63,13 @@
 #include "simple.vert.xxd"
 #include "simpleColor.vert.xxd"
 #include "simple_rect.vert.xxd"
+#include "shape.vert.xxd"
 #include "sprite.vert.xxd"
 #include "tilemap.vert.xxd"
 #include "blur.frag.xxd"
+#include "kawaseDown.frag.xxd"
+#include "kawaseUp.frag.xxd"
+#include "radialBlur.frag.xxd"
 #include "simpleMatrix.vert.xxd"
 #include "blurH.vert.xxd"
 #include "blurV.vert.xxd"
@@ -82,7 +82,7 @@
   shader_##frag##_frag_len, #vert, #frag, #name); \
 }
 
-#define GET_U(name) u_##name = gl.GetUniformLocation(program, #name)
+#define GET_U(name) addUniform(&u_##name, #name)
 
 static void write_log(const std::string &name, const std::string &log)
 {
@@ -115,28 +115,33 @@ static void printProgramLog(GLuint program)
 }
 
 Shader::Shader()
-{
-  vertShader = gl.CreateShader(GL_VERTEX_SHADER);
-  fragShader = gl.CreateShader(GL_FRAGMENT_SHADER);
-  program = gl.CreateProgram();
-}
+  : vertShader(0), fragShader(0), program(0),
+    vertSrc(0), fragSrc(0), vertSize(0), fragSize(0),
+    vertName(0), fragName(0), programName(0), linked(false)
+{}
 
 Shader::~Shader()
 {
+  if (!program)
+    return;
   gl.UseProgram(0);
   gl.DeleteProgram(program);
-  gl.DeleteShader(vertShader);
-  gl.DeleteShader(fragShader);
+  if (vertShader)
+    gl.DeleteShader(vertShader);
+  if (fragShader)
+    gl.DeleteShader(fragShader);
 }
 
 void Shader::bind()
 {
+  if (!linked)
+    link();
   glState.program.set(program);
 }
 
 void Shader::unbind()
 {
-  gl.ActiveTexture(GL_TEXTURE0);
+  TEX::setActiveUnit(0);
   glState.program.set(0);
 }
 
@@ -171,10 +176,52 @@ void Shader::init(const unsigned char *vert, int vertSize,
                   const unsigned char *frag, int fragSize,
                   const char *vertName, const char *fragName,
                   const char *programName)
+{
+  vertSrc = vert;
+  this->vertSize = vertSize;
+  fragSrc = frag;
+  this->fragSize = fragSize;
+  this->vertName = vertName;
+  this->fragName = fragName;
+  this->programName = programName;
+}
+
+void Shader::addUniform(GLint *location, const char *name)
+{
+  if (linked) {
+    *location = gl.GetUniformLocation(program, name);
+    return;
+  }
+  *location = -1;
+  Uniform uniform = { location, name };
+  uniforms.push_back(uniform);
+}
+
+void Shader::link()
+{
+  linked = true;
+  uint64_t key = ShaderCache::hash(ShaderCache::driverKey(), &gl.glsles, sizeof(gl.glsles));
+  key = ShaderCache::hash(key, shader_common_h, shader_common_h_len);
+  key = ShaderCache::hash(key, vertSrc, vertSize);
+  key = ShaderCache::hash(key, fragSrc, fragSize);
+  bool cache = ShaderCache::enabled();
+  program = gl.CreateProgram();
+  if (!cache || !ShaderCache::load(program, programName, key))
+    compile(cache, key);
+  for (size_t i = 0; i < uniforms.size(); ++i)
+    *uniforms[i].location = gl.GetUniformLocation(program, uniforms[i].name);
+  uniforms.clear();
+  // Sources may point to temporaries, see initFromFile
+  vertSrc = fragSrc = 0;
+}
+
+void Shader::compile(bool cache, uint64_t key)
 {
   GLint success;
+  vertShader = gl.CreateShader(GL_VERTEX_SHADER);
+  fragShader = gl.CreateShader(GL_FRAGMENT_SHADER);
   /* Compile vertex shader */
-  setupShaderSource(vertShader, GL_VERTEX_SHADER, vert, vertSize);
+  setupShaderSource(vertShader, GL_VERTEX_SHADER, vertSrc, vertSize);
   gl.CompileShader(vertShader);
   gl.GetShaderiv(vertShader, GL_COMPILE_STATUS, &success);
   if (!success) {
@@ -183,7 +230,7 @@ void Shader::init(const unsigned char *vert, int vertSize,
       "GLSL: An error occured while compiling vertex shader '%s' in program '%s'",
       vertName, programName);
   }// Compile fragment shader
-  setupShaderSource(fragShader, GL_FRAGMENT_SHADER, frag, fragSize);
+  setupShaderSource(fragShader, GL_FRAGMENT_SHADER, fragSrc, fragSize);
   gl.CompileShader(fragShader);
   gl.GetShaderiv(fragShader, GL_COMPILE_STATUS, &success);
   if (!success) {
@@ -197,6 +244,9 @@ void Shader::init(const unsigned char *vert, int vertSize,
   gl.BindAttribLocation(program, Position, "position");
   gl.BindAttribLocation(program, TexCoord, "texCoord");
   gl.BindAttribLocation(program, Color, "color");
+  gl.BindAttribLocation(program, Shape, "shape");
+  if (cache && gl.ProgramParameteri)
+    gl.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   gl.LinkProgram(program);
   gl.GetProgramiv(program, GL_LINK_STATUS, &success);
   if (!success) {
@@ -205,6 +255,8 @@ void Shader::init(const unsigned char *vert, int vertSize,
       "GLSL: An error occured while linking program '%s' (vertex '%s', fragment '%s')",
       programName, vertName, fragName);
   }
+  if (cache)
+    ShaderCache::store(program, programName, key);
 }
 
 void Shader::initFromFile(const char *_vertFile, const char *_fragFile,
@@ -216,6 +268,8 @@ void Shader::initFromFile(const char *_vertFile, const char *_fragFile,
   init((const unsigned char*) vertContents.c_str(), vertContents.size(),
        (const unsigned char*) fragContents.c_str(), fragContents.size(),
        _vertFile, _fragFile, programName);
+  // The contents are gone once this returns, so no lazy linking here
+  link();
 }
 
 void Shader::setVec4Uniform(GLint location, const Vec4 &vec)
@@ -225,11 +279,10 @@ void Shader::setVec4Uniform(GLint location, const Vec4 &vec)
 
 void Shader::setTexUniform(GLint location, unsigned unitIndex, TEX::ID texture)
 {
-  GLenum texUnit = GL_TEXTURE0 + unitIndex;
-  gl.ActiveTexture(texUnit);
-  gl.BindTexture(GL_TEXTURE_2D, texture.gl);
+  TEX::setActiveUnit(unitIndex);
+  TEX::bind(texture);
   gl.Uniform1i(location, unitIndex);
-  gl.ActiveTexture(GL_TEXTURE0);
+  TEX::setActiveUnit(0);
 }
 
 void ShaderBase::GLProjMat::apply(const Vec2i &value)
@@ -252,7 +305,7 @@ void ShaderBase::init()
 {
   GET_U(texSizeInv);
   GET_U(translation);
-  projMat.u_mat = gl.GetUniformLocation(program, "projMat");
+  addUniform(&projMat.u_mat, "projMat");
 }
 
 void ShaderBase::applyViewportProj()
@@ -263,11 +316,23 @@ void ShaderBase::applyViewportProj()
 
 void ShaderBase::setTexSize(const Vec2i &value)
 {
+  if (value == texSize) {
+    ++GLState::counters.elided;
+    return;
+  }
+  ++GLState::counters.issued;
+  texSize = value;
   gl.Uniform2f(u_texSizeInv, 1.f / value.x, 1.f / value.y);
 }
 
 void ShaderBase::setTranslation(const Vec2i &value)
 {
+  if (value == translation) {
+    ++GLState::counters.elided;
+    return;
+  }
+  ++GLState::counters.issued;
+  translation = value;
   gl.Uniform2f(u_translation, value.x, value.y);
 }
 
@@ -283,6 +348,30 @@ void FlatColorShader::setColor(const Vec4 &value)
   setVec4Uniform(u_color, value);
 }
 
+ViewportEffectShader::ViewportEffectShader()
+{
+  INIT_SHADER(simple, viewportEffect, ViewportEffectShader);
+  ShaderBase::init();
+  GET_U(tone);
+  GET_U(color);
+  GET_U(flash);
+}
+
+void ViewportEffectShader::setTone(const Vec4 &value)
+{
+  setVec4Uniform(u_tone, value);
+}
+
+void ViewportEffectShader::setColor(const Vec4 &value)
+{
+  setVec4Uniform(u_color, value);
+}
+
+void ViewportEffectShader::setFlash(const Vec4 &value)
+{
+  setVec4Uniform(u_flash, value);
+}
+
 SimpleShader::SimpleShader()
 {
   INIT_SHADER(simple, simple, SimpleShader);
@@ -553,22 +642,6 @@ SepiaShader::SepiaShader()
   ShaderBase::init();
 }
 
-BasicColorShader::BasicColorShader()
-{
-  INIT_SHADER(simple, basic_color, BasicColorShader);
-  ShaderBase::init();
-  GET_U(red);
-  GET_U(green);
-  GET_U(blue);
-}
-
-void BasicColorShader::set_color(float r, float g, float b)
-{
-  gl.Uniform1f(u_red, r);
-  gl.Uniform1f(u_green, g);
-  gl.Uniform1f(u_blue, b);
-}
-
 GradientShader::GradientShader()
 {
   INIT_SHADER(simple, gradient, GradientShader);
@@ -610,87 +683,75 @@ void GradientSpriteShader::set_origin(const Vec2 &origin)
   gl.Uniform2f(u_origin, origin.x, origin.y);
 }
 
-GradientMapShader::GradientMapShader()
-{
-  INIT_SHADER(simple, gradient_map, GradientMapShader);
-  ShaderBase::init();
-  GET_U(opacity);
-  GET_U(origin);
-  GET_U(resolution);
-  GET_U(c1);
-  GET_U(c2);
-}
-
-void GradientMapShader::set_opacity(int opaque)
-{
-  gl.Uniform1f(u_opacity, opaque / 255.0f);
-}
-
 ThermalShader::ThermalShader()
 {
   INIT_SHADER(simple, thermal, ThermalShader);
   ShaderBase::init();
 }
 
-VignetteShader::VignetteShader()
-{
-  INIT_SHADER(simple, vignette, VignetteShader);
-  ShaderBase::init();
-  GET_U(resolution);
-}
-
-void VignetteShader::set_resolution(float w, float h)
+FilterChainShader::FilterChainShader()
 {
-  gl.Uniform2f(u_resolution, w, h);
-}
-
-GrayVignetteShader::GrayVignetteShader()
-{
-  INIT_SHADER(simple, vignette_gray, GrayVignetteShader);
+  INIT_SHADER(simple, filter_chain, FilterChainShader);
   ShaderBase::init();
-  GET_U(resolution);
+  GET_U(ops);
+  GET_U(params);
+  GET_U(opCount);
 }
 
-SepiaVignetteShader::SepiaVignetteShader()
+void FilterChainShader::setOps(const float *ops, const Vec4 *params, int count)
 {
-  INIT_SHADER(simple, vignette_sepia, SepiaVignetteShader);
-  ShaderBase::init();
-  GET_U(resolution);
+  float values[FILTER_CHAIN_MAX * 4];
+  for (int i = 0; i < count; i++) {
+    values[i * 4] = params[i].x;
+    values[i * 4 + 1] = params[i].y;
+    values[i * 4 + 2] = params[i].z;
+    values[i * 4 + 3] = params[i].w;
+  }
+  gl.Uniform1fv(u_ops, count, ops);
+  gl.Uniform4fv(u_params, count, values);
+  gl.Uniform1i(u_opCount, count);
 }
 
-RedVignetteShader::RedVignetteShader()
+HitMaskShader::HitMaskShader()
 {
-  INIT_SHADER(simple, vignette_red, RedVignetteShader);
+  INIT_SHADER(simple, hitmask, HitMaskShader);
   ShaderBase::init();
-  GET_U(resolution);
+  GET_U(sourceSize);
 }
 
-GreenVignetteShader::GreenVignetteShader()
+void HitMaskShader::setSourceSize(const Vec2i &value)
 {
-  INIT_SHADER(simple, vignette_green, GreenVignetteShader);
-  ShaderBase::init();
-  GET_U(resolution);
+  gl.Uniform2f(u_sourceSize, value.x, value.y);
 }
 
-BlueVignetteShader::BlueVignetteShader()
+SnapshotShader::SnapshotShader()
 {
-  INIT_SHADER(simple, vignette_blue, BlueVignetteShader);
+  INIT_SHADER(simple, snapshot, SnapshotShader);
   ShaderBase::init();
   GET_U(resolution);
+  GET_U(gray);
+  GET_U(tint);
+  GET_U(c1);
+  GET_U(c2);
+  GET_U(origin);
+  GET_U(gradient);
+  GET_U(vignette);
 }
 
-YellowVignetteShader::YellowVignetteShader()
+void SnapshotShader::setResolution(const Vec2i &value)
 {
-  INIT_SHADER(simple, vignette_yellow, YellowVignetteShader);
-  ShaderBase::init();
-  GET_U(resolution);
+  gl.Uniform2f(u_resolution, value.x, value.y);
 }
 
-BlackVignetteShader::BlackVignetteShader()
+void SnapshotShader::setEffect(const SnapshotEffect &fx)
 {
-  INIT_SHADER(simple, vignette_black, BlackVignetteShader);
-  ShaderBase::init();
-  GET_U(resolution);
+  gl.Uniform1f(u_gray, fx.gray);
+  setVec4Uniform(u_tint, fx.tint);
+  setVec4Uniform(u_c1, fx.c1);
+  setVec4Uniform(u_c2, fx.c2);
+  gl.Uniform2f(u_origin, fx.origin.x, fx.origin.y);
+  gl.Uniform1f(u_gradient, fx.gradient);
+  gl.Uniform1f(u_vignette, fx.vignette);
 }
 
 RoundedRectShader::RoundedRectShader()
@@ -825,6 +886,12 @@ void PolygonShader::set_angle(float angle)
   gl.Uniform1f(u_angle, angle);
 }
 
+ShapeShader::ShapeShader()
+{
+  INIT_SHADER(shape, shape, ShapeShader);
+  ShaderBase::init();
+}
+
 TilemapShader::TilemapShader()
 {
   INIT_SHADER(tilemap, simple, TilemapShader);
@@ -885,6 +952,51 @@ BlurShader::VPass::VPass()
   ShaderBase::init();
 }
 
+KawaseShader::Down::Down()
+{
+  INIT_SHADER(simple, kawaseDown, KawaseShader::Down);
+  ShaderBase::init();
+  GET_U(halfPixel);
+}
+
+KawaseShader::Up::Up()
+{
+  INIT_SHADER(simple, kawaseUp, KawaseShader::Up);
+  ShaderBase::init();
+  GET_U(halfPixel);
+}
+
+void KawaseShader::Pass::setHalfPixel(const Vec2 &value)
+{
+  gl.Uniform2f(u_halfPixel, value.x, value.y);
+}
+
+RadialBlurShader::RadialBlurShader()
+{
+  INIT_SHADER(simple, radialBlur, RadialBlurShader);
+  ShaderBase::init();
+  GET_U(size);
+  GET_U(baseAngle);
+  GET_U(angleStep);
+  GET_U(samples);
+}
+
+void RadialBlurShader::setSize(const Vec2i &value)
+{
+  gl.Uniform2f(u_size, value.x, value.y);
+}
+
+void RadialBlurShader::setAngles(float base, float step)
+{
+  gl.Uniform1f(u_baseAngle, base);
+  gl.Uniform1f(u_angleStep, step);
+}
+
+void RadialBlurShader::setSamples(int value)
+{
+  gl.Uniform1i(u_samples, value);
+}
+
 TilemapVXShader::TilemapVXShader()
 {
   INIT_SHADER(tilemapvx, simple, TilemapVXShader);
@@ -25,6 +25,8 @@
 #include "etc-internal.h"
 #include "gl-util.h"
 #include "glstate.h"
+#include <stdint.h>
+#include <vector>
 
 class Shader
 {
@@ -36,23 +38,43 @@ public:
   {
     Position = 0,
     TexCoord = 1,
-    Color = 2
+    Color = 2,
+    Shape = 3
   };
 
 protected:
   Shader();
   ~Shader();
 
+  /* Only records the sources, compiling and linking are left
+   * for the first bind() so unused programs cost nothing */
   void init(const unsigned char *vert, int vertSize,
             const unsigned char *frag, int fragSize,
             const char *vertName, const char *fragName,
             const char *programName);
   void initFromFile(const char *vertFile, const char *fragFile,
                     const char *programName);
+  // 'location' is filled in once the program got linked
+  void addUniform(GLint *location, const char *name);
   static void setVec4Uniform(GLint location, const Vec4 &vec);
   static void setTexUniform(GLint location, unsigned unitIndex, TEX::ID texture);
   GLuint vertShader, fragShader;
   GLuint program;
+
+private:
+  void link();
+  void compile(bool cache, uint64_t key);
+
+  struct Uniform
+  {
+    GLint *location;
+    const char *name;
+  };
+  std::vector<Uniform> uniforms;
+  const unsigned char *vertSrc, *fragSrc;
+  int vertSize, fragSize;
+  const char *vertName, *fragName, *programName;
+  bool linked;
 };
 
 class ShaderBase : public Shader
@@ -79,6 +101,11 @@ public:
 protected:
   void init();
   GLint u_texSizeInv, u_translation;
+
+private:
+  /* Last values loaded into the program's uniforms,
+   * both start out at GL's default of zero */
+  Vec2i texSize, translation;
 };
 
 class FlatColorShader : public ShaderBase
@@ -91,6 +118,19 @@ private:
   GLint u_color;
 };
 
+// Gray, tone, color and flash of a viewport in one pass
+class ViewportEffectShader : public ShaderBase
+{
+public:
+  ViewportEffectShader();
+  void setTone(const Vec4 &value);
+  void setColor(const Vec4 &value);
+  void setFlash(const Vec4 &value);
+
+private:
+  GLint u_tone, u_color, u_flash;
+};
+
 class SimpleShader : public ShaderBase
 {
 public:
@@ -237,16 +277,6 @@ public:
   SepiaShader();
 };
 
-class BasicColorShader : public ShaderBase
-{
-public:
-  BasicColorShader();
-  void set_color(float r, float g, float b);
-
-private:
-  GLint u_red, u_green, u_blue;
-};
-
 class GradientShader : public ShaderBase
 {
 public:
@@ -264,69 +294,66 @@ public:
   void set_origin(const Vec2 &origin);
 };
 
-class GradientMapShader : public GradientShader
-{
-public:
-  GradientMapShader();
-  void set_opacity(int opaque);
-private:
-  GLint u_opacity;
-};
-
 class ThermalShader : public ShaderBase
 {
 public:
   ThermalShader();
 };
 
-class VignetteShader : public ShaderBase
-{
-public:
-  VignetteShader();
-  void set_resolution(float w, float h);
-  GLint u_resolution, u_color;
-};
+// Maximum number of operations filter_chain.frag runs in one pass
+#define FILTER_CHAIN_MAX 8
 
-class GrayVignetteShader : public VignetteShader
+class FilterChainShader : public ShaderBase
 {
 public:
-  GrayVignetteShader();
-};
+  FilterChainShader();
+  /* 'ops' holds Bitmap::Filter types and 'params' their arguments,
+   * 'count' must not exceed FILTER_CHAIN_MAX */
+  void setOps(const float *ops, const Vec4 *params, int count);
 
-class SepiaVignetteShader : public VignetteShader
-{
-public:
-  SepiaVignetteShader();
+private:
+  GLint u_ops, u_params, u_opCount;
 };
 
-class RedVignetteShader : public VignetteShader
+class HitMaskShader : public ShaderBase
 {
 public:
-  RedVignetteShader();
-};
+  HitMaskShader();
+  void setSourceSize(const Vec2i &value);
 
-class GreenVignetteShader : public VignetteShader
-{
-public:
-  GreenVignetteShader();
+private:
+  GLint u_sourceSize;
 };
 
-class BlueVignetteShader : public VignetteShader
+/* Everything a screen snapshot can apply on top of the scene,
+ * the defaults leave it untouched */
+struct SnapshotEffect
 {
-public:
-  BlueVignetteShader();
-};
+  // How much the scene gets desaturated before tinting
+  float gray;
+  // Luma multiplier in rgb, alpha is how much of it replaces the color
+  Vec4 tint;
+  // Coverage of a radial gradient going from c1 to c2
+  float gradient;
+  // Center of that gradient in normalized screen coordinates
+  Vec2 origin;
+  Vec4 c1, c2;
+  // Darkens everything outside a centered circle
+  float vignette;
 
-class YellowVignetteShader : public VignetteShader
-{
-public:
-  YellowVignetteShader();
+  SnapshotEffect() : gray(0), gradient(0), vignette(0) {}
 };
 
-class BlackVignetteShader : public VignetteShader
+class SnapshotShader : public ShaderBase
 {
 public:
-  BlackVignetteShader();
+  SnapshotShader();
+  void setResolution(const Vec2i &value);
+  void setEffect(const SnapshotEffect &fx);
+
+private:
+  GLint u_resolution, u_gray, u_tint, u_c1, u_c2;
+  GLint u_origin, u_gradient, u_vignette;
 };
 
 class RoundedRectShader : public ShaderBase
@@ -383,6 +410,13 @@ private:
   GLint u_center, u_rect_wh, u_color, u_sides, u_radius, u_angle;
 };
 
+// Draws a batch of ShapeVertex quads, see Bitmap::drawShapes
+class ShapeShader : public ShaderBase
+{
+public:
+  ShapeShader();
+};
+
 class TilemapShader : public ShaderBase
 {
 public:
@@ -442,6 +476,48 @@ struct BlurShader
   VPass pass2;
 };
 
+// Dual Kawase blur, see Bitmap::blur(int)
+struct KawaseShader
+{
+  class Pass : public ShaderBase
+  {
+  public:
+    void setHalfPixel(const Vec2 &value);
+
+  protected:
+    GLint u_halfPixel;
+  };
+
+  class Down : public Pass
+  {
+  public:
+    Down();
+  };
+
+  class Up : public Pass
+  {
+  public:
+    Up();
+  };
+
+  Down down;
+  Up up;
+};
+
+class RadialBlurShader : public ShaderBase
+{
+public:
+  RadialBlurShader();
+  // Size of the texture in pixels, rotations happen in that space
+  void setSize(const Vec2i &value);
+  // Angles are in radians
+  void setAngles(float base, float step);
+  void setSamples(int value);
+
+private:
+  GLint u_size, u_baseAngle, u_angleStep, u_samples;
+};
+
 class TilemapVXShader : public ShaderBase
 {
 public:
@@ -480,6 +556,7 @@ private:
 struct ShaderSet
 {
   FlatColorShader flatColor;
+  ViewportEffectShader viewportEffect;
   SimpleShader simple;
   SimpleColorShader simpleColor;
   SimpleAlphaShader simpleAlpha;
@@ -492,23 +569,16 @@ struct ShaderSet
   AlphaMaskShader alpha_mask;
   ColorMaskShader color_mask;
   ThermalShader thermal;
+  FilterChainShader filter_chain;
+  HitMaskShader hit_mask;
   SepiaShader sepia;
-  BasicColorShader basic_color;
-  GradientShader gradient;
-  GradientMapShader gradient_map;
   GradientSpriteShader gradient_sprite;
-  VignetteShader vignette;
-  GrayVignetteShader vignette_gray;
-  SepiaVignetteShader vignette_sepia;
-  RedVignetteShader vignette_red;
-  GreenVignetteShader vignette_green;
-  BlueVignetteShader vignette_blue;
-  YellowVignetteShader vignette_yellow;
-  BlackVignetteShader vignette_black;
+  SnapshotShader snapshot;
   RoundedRectShader rounded_rect;
   CircleShader circle;
   TriangleShader triangle;
   PolygonShader polygon;
+  ShapeShader shape;
   TilemapShader tilemap;
   FlashMapShader flashMap;
   TransShader trans;
@@ -518,6 +588,8 @@ struct ShaderSet
   ObscuredShader obscured;
   SimpleMatrixShader simpleMatrix;
   BlurShader blur;
+  KawaseShader kawase;
+  RadialBlurShader radialBlur;
   TilemapVXShader tilemapVX;
 };
 
@@ -0,0 +1,189 @@
+/*
+** shadercache.cpp
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "shadercache.h"
+#include <SDL_filesystem.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef __WINDOWS__
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#include "sharedstate.h"
+#include "config.h"
+
+#define CACHE_DIR "ShaderCache"
+// Bump whenever the file layout changes
+#define CACHE_VERSION 1
+
+struct CacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t size;
+};
+
+static const char cacheMagic[4] = { 'H', 'C', 'S', 'C' };
+
+/* Lives in the user's pref folder, the game folder may well be
+ * read-only. Empty if SDL can't provide one, caching is off then */
+static const std::string &directory()
+{
+  static bool resolved = false;
+  static std::string dir;
+  if (resolved)
+    return dir;
+  resolved = true;
+  const Config &conf = shState->config();
+  const char *org = conf.dataPathOrg.empty() ? "HiddenChest" : conf.dataPathOrg.c_str();
+  const char *app = conf.dataPathApp.empty() ? "HiddenChest" : conf.dataPathApp.c_str();
+  char *pref = SDL_GetPrefPath(org, app);
+  if (!pref)
+    return dir;
+  dir = std::string(pref) + CACHE_DIR;
+  SDL_free(pref);
+  return dir;
+}
+
+static std::string entryPath(const char *name)
+{
+  // Nested shader names such as "BlurShader::HPass" contain colons
+  std::string file(name);
+  for (size_t i = 0; i < file.size(); ++i)
+    if (file[i] == ':')
+      file[i] = '_';
+  return directory() + "/" + file + ".bin";
+}
+
+static bool makeDirectory(const std::string &path)
+{
+#ifdef __WINDOWS__
+  return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+namespace ShaderCache
+{
+
+bool enabled()
+{
+  static GLint formats = -1;
+  if (!gl.GetProgramBinary || !gl.ProgramBinary)
+    return false;
+  if (!shState || !shState->config().shaderCache)
+    return false;
+  if (directory().empty())
+    return false;
+  if (formats < 0)
+    gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+uint64_t driverKey()
+{
+  static uint64_t key = 0;
+  if (key)
+    return key;
+  const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+  key = hash(0, 0, 0);
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    const char *str = (const char*) gl.GetString(names[i]);
+    if (str)
+      key = hash(key, str, strlen(str) + 1);
+  }
+  return key;
+}
+
+uint64_t hash(uint64_t seed, const void *data, size_t size)
+{ // 64 bit FNV-1a, a zero seed starts a new hash
+  uint64_t h = seed ? seed : 14695981039346656037ULL;
+  const unsigned char *bytes = (const unsigned char*) data;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= bytes[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+bool load(GLuint program, const char *name, uint64_t key)
+{
+  FILE *f = fopen(entryPath(name).c_str(), "rb");
+  if (!f)
+    return false;
+  CacheHeader header;
+  bool valid = fread(&header, sizeof(header), 1, f) == 1 &&
+               !memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) &&
+               header.version == CACHE_VERSION && header.key == key;
+  std::vector<char> blob;
+  if (valid) {
+    blob.resize(header.size);
+    valid = header.size > 0 && fread(&blob[0], header.size, 1, f) == 1;
+  }
+  fclose(f);
+  if (!valid)
+    return false;
+  gl.ProgramBinary(program, header.format, &blob[0], header.size);
+  // Driver updates may reject old binaries even with matching strings
+  GLint success;
+  gl.GetProgramiv(program, GL_LINK_STATUS, &success);
+  return success;
+}
+
+void store(GLuint program, const char *name, uint64_t key)
+{
+  GLint size = 0;
+  gl.GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0)
+    return;
+  std::vector<char> blob(size);
+  GLsizei length = 0;
+  GLenum format = 0;
+  gl.GetProgramBinary(program, size, &length, &format, &blob[0]);
+  if (length <= 0)
+    return;
+  // Without a place to write to the shaders just get linked each run
+  static bool writable = makeDirectory(directory());
+  if (!writable)
+    return;
+  std::string path = entryPath(name);
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f)
+    return;
+  CacheHeader header;
+  memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.version = CACHE_VERSION;
+  header.key = key;
+  header.format = format;
+  header.size = length;
+  fwrite(&header, sizeof(header), 1, f);
+  fwrite(&blob[0], length, 1, f);
+  fclose(f);
+}
+
+}
@@ -0,0 +1,45 @@
+/*
+** shadercache.h
+**
+** This file is part of HiddenChest.
+**
+** Copyright (C) 2024 Kyonides-Arkanthes <kyonides@gmail.com>
+**
+** HiddenChest is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 of the License, or
+** (at your option) any later version.
+**
+** HiddenChest is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with HiddenChest.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include "gl-fun.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keeps linked program binaries in the SDL pref folder, so
+ * later launches skip compiling. Entries are keyed by the
+ * driver strings plus a hash of the shader sources, anything
+ * not matching is simply compiled and written out again */
+namespace ShaderCache
+{
+  // False if the driver can't hand out binaries or it got disabled
+  bool enabled();
+  // Hash seeded with the vendor, renderer and version strings
+  uint64_t driverKey();
+  uint64_t hash(uint64_t seed, const void *data, size_t size);
+  // Loads 'name' into 'program' if its key matches, true on success
+  bool load(GLuint program, const char *name, uint64_t key);
+  void store(GLuint program, const char *name, uint64_t key);
+}
+
+#endif // SHADERCACHE_H
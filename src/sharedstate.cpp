@@ -30,11 +30,16 @@
 #include "glstate.h"
 #include "shader.h"
 #include "texpool.h"
+#include "imagecache.h"
+#include "imageloader.h"
 #include "font.h"
 #include "eventthread.h"
+#include "benchmark.h"
 #include "gl-util.h"
+#include "gl-meta.h"
 #include "global-ibo.h"
 #include "quad.h"
+#include "quadarray.h"
 #include "binding.h"
 #include "exception.h"
 #include "audio/sharedmidistate.h"
@@ -79,6 +84,10 @@ struct SharedStatePrivate
   GLState _glState;
   ShaderSet shaders;
   TexPool texPool;
+  // Declared after texPool so it gets destroyed first
+  ImageCache imageCache;
+  // Stops its worker threads before fileSystem goes away
+  ImageLoader imageLoader;
   SharedFontState fontState;
   Font *defaultFont;
   TEX::ID globalTex;
@@ -88,6 +97,8 @@ struct SharedStatePrivate
   TEXFBO gpTexFBO;
   TEXFBO atlasTex;
   Quad gpQuad;
+  // Created the first time a Bitmap draws shapes
+  ShapeQuadArray *shapeQuads;
   unsigned int stampCounter;
   std::chrono::time_point<std::chrono::steady_clock> startupTime;
 
@@ -103,14 +114,13 @@ struct SharedStatePrivate
         input(*threadData),
         audio(*threadData),
         _glState(threadData->config),
+        imageCache((uint64_t) threadData->config.imageCacheSize * 1024 * 1024),
         fontState(threadData->config),
+        shapeQuads(0),
         stampCounter(0),
         block_close(false)
   {
     startupTime = std::chrono::steady_clock::now();
-    // Shaders have been compiled in ShaderSet's constructor
-    if (gl.ReleaseShaderCompiler)
-      gl.ReleaseShaderCompiler();
     // Moved Encrypted Data to a separate function
     fileSystem.addPath(".");
     fileSystem.initFontSets(fontState);
@@ -133,6 +143,8 @@ struct SharedStatePrivate
 
   ~SharedStatePrivate()
   {
+    GLMeta::streamFini();
+    delete shapeQuads;
     TEX::del(globalTex);
     TEXFBO::fini(gpTexFBO);
     TEXFBO::fini(atlasTex);
@@ -292,11 +304,28 @@ TexPool& SharedState::texPool() const
   return p->texPool;
 }
 
+ImageCache& SharedState::imageCache() const
+{
+  return p->imageCache;
+}
+
+ImageLoader& SharedState::imageLoader() const
+{
+  return p->imageLoader;
+}
+
 Quad& SharedState::gpQuad() const
 {
   return p->gpQuad;
 }
 
+ShapeQuadArray& SharedState::shapeQuads()
+{
+  if (!p->shapeQuads)
+    p->shapeQuads = new ShapeQuadArray;
+  return *p->shapeQuads;
+}
+
 SharedFontState& SharedState::fontState() const
 {
   return p->fontState;
@@ -426,6 +455,8 @@ Font &SharedState::defaultFont() const
 unsigned long long SharedState::runTime() {
   if (!p)
     return 0;
+  if (Benchmark::active())
+    return Benchmark::runTime();
   const auto now = std::chrono::steady_clock::now();
   return std::chrono::duration_cast<std::chrono::microseconds>(now - p->startupTime).count();
 }
@@ -37,6 +37,8 @@ struct GlobalIBO;
 struct SDL_Window;
 struct TEXFBO;
 struct Quad;
+struct ShapeVertex;
+template<class VertexType> struct QuadArray;
 struct ShaderSet;
 class Scene;
 class FileSystem;
@@ -46,6 +48,8 @@ class Input;
 class Audio;
 class GLState;
 class TexPool;
+class ImageCache;
+class ImageLoader;
 class Font;
 class SharedFontState;
 struct GlobalIBO;
@@ -72,6 +76,8 @@ struct SharedState
   GLState &_glState() const;
   ShaderSet &shaders() const;
   TexPool &texPool() const;
+  ImageCache &imageCache() const;
+  ImageLoader &imageLoader() const;
   SharedFontState &fontState() const;
   Font &defaultFont() const;
   SharedMidiState &midiState() const;
@@ -88,6 +94,8 @@ struct SharedState
   void ensureTexSize(int minW, int minH, Vec2i &currentSizeOut);
   TEXFBO &gpTexFBO(int minW, int minH);
   Quad &gpQuad() const;
+  // Vertex buffer Bitmap::drawShapes fills, created on first use
+  QuadArray<ShapeVertex> &shapeQuads();
   // Basically just a simple "TexPool" replacement for Tilemap atlas use
   void requestAtlasTex(int w, int h, TEXFBO &out);
   void releaseAtlasTex(TEXFBO &tex);
@@ -32,7 +32,10 @@
 #include "shader.h"
 #include "glstate.h"
 #include "quadarray.h"
+#include "graphics.h"
+#include "pickindex.h"
 #include <math.h>
+#include <algorithm>
 #include <SDL_rect.h>
 #include <sigc++/connection.h>
 #include "debugwriter.h"
@@ -64,6 +67,9 @@ struct SpritePrivate
   BlendType blendType;
   IntRect sceneRect;
   Vec2i sceneOrig;
+  // Screen position of the scene, sceneRect is kept at 0, 0
+  Vec2i scenePos;
+  PickEntry pick;
   bool isVisible;// Would this sprite be visible on the screen if drawn?
   Color *color;
   Tone *tone;
@@ -82,7 +88,7 @@ struct SpritePrivate
   } wave;
   EtcTemps tmp;
   sigc::connection prepareCon;
-  SpritePrivate()
+  SpritePrivate(Sprite *self)
   : bitmap(0),
     srcRect(&tmp.rect),
     obscured(false),
@@ -101,6 +107,7 @@ struct SpritePrivate
     reduced_height(0),
     reduce_speed(ROWH),
     drag_margin_y(8),
+    pick(self),
     isVisible(false),
     color(&tmp.color),
     tone(&tmp.tone)
@@ -120,6 +127,8 @@ struct SpritePrivate
   {
     srcRectCon.disconnect();
     prepareCon.disconnect();
+    if (pick.slot >= 0)
+      shState->graphics().pickIndex().remove(pick);
   }
 
   void update_reduce_width()
@@ -217,6 +226,104 @@ struct SpritePrivate
     isVisible = SDL_HasIntersection(&self, &sceneRect);
   }
 
+  // Screen space bounding box of what gets drawn, clipped to the scene
+  IntRect screenRect()
+  {
+    if (!isVisible)
+      return IntRect();
+    IntRect rect = srcRect->toIntRect();
+    rect.w = clamp<int>(rect.w, 0, bitmap->width() - reduced_width - rect.x);
+    rect.h = clamp<int>(rect.h, 0, bitmap->height() - reduced_height - rect.y);
+    const float *m = trans.getMatrix();
+    float x1 = m[12], y1 = m[13];
+    float x2 = x1, y2 = y1;
+    for (int i = 1; i < 4; i++) {
+      float cx = (i & 1) ? rect.w : 0;
+      float cy = (i & 2) ? rect.h : 0;
+      float x = m[0] * cx + m[4] * cy + m[12];
+      float y = m[1] * cx + m[5] * cy + m[13];
+      x1 = std::min(x1, x);
+      x2 = std::max(x2, x);
+      y1 = std::min(y1, y);
+      y2 = std::max(y2, y);
+    }
+    if (wave.active) {
+      x1 -= wave.amp;
+      x2 += wave.amp;
+    }
+    IntRect box(floorf(x1), floorf(y1), 0, 0);
+    box.w = (int) ceilf(x2) - box.x;
+    box.h = (int) ceilf(y2) - box.y;
+    IntRect scene(scenePos, sceneRect.size());
+    IntRect result;
+    if (!SDL_IntersectRect(&box, &scene, &result))
+      return IntRect();
+    return result;
+  }
+
+  /* Mega surfaces are drawn one texture tile at a time,
+   * without the wave effect */
+  void drawMega(ShaderBase &shader, SpriteShader *bushShader)
+  {
+    IntRect rect = srcRect->toIntRect();
+    rect.w = clamp<int>(rect.w, 0, bitmap->width() - reduced_width - rect.x);
+    rect.h = clamp<int>(rect.h, 0, bitmap->height() - reduced_height - rect.y);
+    // Bush depth in pixels, the shader wants it relative to each tile
+    float bushY = efBushDepth * bitmap->height();
+    Quad &quad = shState->gpQuad();
+    IntRect area;
+    const TEXFBO *tile;
+    for (int i = 0; (tile = bitmap->megaTile(i, area)); ++i) {
+      SDL_Rect part;
+      if (!SDL_IntersectRect(&rect, &area, &part))
+        continue;
+      FloatRect tex(part.x - area.x, part.y - area.y, part.w, part.h);
+      FloatRect pos(part.x - rect.x, part.y - rect.y, part.w, part.h);
+      if (mirrored) {
+        tex = tex.hFlipped();
+        pos.x = rect.w - pos.x - pos.w;
+      }
+      if (mirrored_y) {
+        tex = tex.wFlipped();
+        pos.y = rect.h - pos.y - pos.h;
+      }
+      quad.setTexPosRect(tex, pos);
+      TEX::bind(tile->tex);
+      shader.setTexSize(Vec2i(tile->width, tile->height));
+      if (bushShader)
+        bushShader->setBushDepth((bushY - area.y) / area.h);
+      quad.draw();
+    }
+  }
+
+  // The regular quad, moved to where the Bitmap sits in its atlas page
+  void drawAtlas(ShaderBase &shader, SpriteShader *bushShader,
+                 const TEXFBO &page, const IntRect &slot)
+  {
+    Quad &atlasQuad = shState->gpQuad();
+    for (int i = 0; i < 4; ++i) {
+      atlasQuad.vert[i] = quad.vert[i];
+      atlasQuad.vert[i].texPos.x += slot.x;
+      atlasQuad.vert[i].texPos.y += slot.y;
+    }
+    atlasQuad.vboDirty = true;
+    TEX::bind(page.tex);
+    shader.setTexSize(Vec2i(page.width, page.height));
+    if (bushShader)
+      bushShader->setBushDepth((slot.y + efBushDepth * slot.h) / page.height);
+    atlasQuad.draw();
+  }
+
+  void updatePick(Sprite *self)
+  {
+    Viewport *viewport = self->getViewport();
+    if (nullOrDisposed(viewport))
+      pick.root = self;
+    else
+      pick.root = viewport;
+    shState->graphics().pickIndex().update(pick, screenRect());
+  }
+
   void emitWaveChunk(SVertex *&vert, float phase, int width, float zoomY, int chunkY, int chunkLength)
   {
     float wavePos = phase + (chunkY / (float) wave.length) * (float) (M_PI * 2);
@@ -326,12 +433,14 @@ struct SpritePrivate
       wave.dirty = false;
     }
     updateVisibility();
+    if (pick.data)
+      updatePick(static_cast<Sprite*>(pick.element));
   }
 };
 
 Sprite::Sprite(Viewport *viewport) : ViewportElement(viewport)
 {
-  p = new SpritePrivate;
+  p = new SpritePrivate(this);
   onGeometryChange(scene->getGeometry());
 }
 
@@ -420,6 +529,7 @@ bool Sprite::getWaveRotate() const
 
 void Sprite::setWaveRotate(bool state)
 {
+  Scene::markChanged();
   p->wave.rotated = state;
 }
 
@@ -432,6 +542,7 @@ int Sprite::getBushOpacity() const
 void Sprite::setBushOpacity(NormValue opacity)
 {
   guardDisposed();
+  Scene::markChanged();
   p->bushOpacity = opacity;
 }
 
@@ -444,6 +555,7 @@ int Sprite::getOpacity() const
 void Sprite::setOpacity(NormValue opacity)
 {
   guardDisposed();
+  Scene::markChanged();
   p->opacity = opacity;
 }
 
@@ -456,6 +568,7 @@ Rect& Sprite::getSrcRect() const
 void Sprite::setSrcRect(Rect &rect)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->srcRect = rect;
 }
 
@@ -468,12 +581,14 @@ Color& Sprite::getColor() const
 void Sprite::setColor(Color &color)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->color = color;
 }
 
 void Sprite::setColor(double r, double g, double b, double a)
 {
   guardDisposed();
+  Scene::markChanged();
   p->color->set(r, g, b, a);
 }
 
@@ -486,6 +601,7 @@ Tone& Sprite::getTone() const
 void Sprite::setTone(Tone &tone)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->tone = tone;
 }
 
@@ -494,10 +610,10 @@ void Sprite::setBitmap(Bitmap *bitmap)
   guardDisposed();
   if (p->bitmap == bitmap)
     return;
+  Scene::markChanged();
   p->bitmap = bitmap;
   if (nullOrDisposed(bitmap))
     return;
-  bitmap->ensureNonMega();
   *p->srcRect = bitmap->rect();
   p->onSrcRectChange();
   p->quad.setPosRect(p->srcRect->toFloatRect());
@@ -507,16 +623,19 @@ void Sprite::setBitmap(Bitmap *bitmap)
 
 void Sprite::gray_out()
 {
+  Scene::markChanged();
   p->bitmap->gray_out();
 }
 
 void Sprite::turn_sepia()
 {
+  Scene::markChanged();
   p->bitmap->turn_sepia();
 }
 
 void Sprite::invert_colors()
 {
+  Scene::markChanged();
   p->bitmap->invert_colors();
 }
 
@@ -525,6 +644,7 @@ void Sprite::setX(int nx)
   guardDisposed();
   if (p->trans.getPosition().x == nx)
     return;
+  Scene::markChanged();
   p->trans.setPosition(Vec2(nx, getY()));
 }
 
@@ -533,6 +653,7 @@ void Sprite::setY(int ny)
   guardDisposed();
   if (p->trans.getPosition().y == ny)
     return;
+  Scene::markChanged();
   p->trans.setPosition(Vec2(getX(), ny));
   if (!p->wave.active)
     return;
@@ -543,6 +664,7 @@ void Sprite::setY(int ny)
 void Sprite::set_xy(int nx, int ny)
 {
   guardDisposed();
+  Scene::markChanged();
   if (p->trans.getPosition().x != nx || p->trans.getPosition().y != ny)
     p->trans.setPosition(Vec2(nx, ny));
   if (!p->wave.active)
@@ -556,6 +678,7 @@ void Sprite::setOX(int value)
   guardDisposed();
   if (p->trans.getOrigin().x == value)
     return;
+  Scene::markChanged();
   p->trans.setOrigin(Vec2(value, getOY()));
 }
 
@@ -564,6 +687,7 @@ void Sprite::setOY(int value)
   guardDisposed();
   if (p->trans.getOrigin().y == value)
     return;
+  Scene::markChanged();
   p->trans.setOrigin(Vec2(getOX(), value));
 }
 
@@ -572,6 +696,7 @@ void Sprite::setZoomX(float value)
   guardDisposed();
   if (p->trans.getScale().x == value)
     return;
+  Scene::markChanged();
   p->trans.setScale(Vec2(value, getZoomY()));
 }
 
@@ -580,6 +705,7 @@ void Sprite::setZoomY(float value)
   guardDisposed();
   if (p->trans.getScale().y == value)
     return;
+  Scene::markChanged();
   p->trans.setScale(Vec2(getZoomX(), value));
   p->recomputeBushDepth();
   p->wave.dirty = true;
@@ -590,6 +716,7 @@ void Sprite::setAngle(float value)
   guardDisposed();
   if (p->trans.getRotation() == value)
     return;
+  Scene::markChanged();
   p->trans.setRotation(value);
 }
 
@@ -598,6 +725,7 @@ void Sprite::setMirror(bool mirrored)
   guardDisposed();
   if (p->mirrored == mirrored)
     return;
+  Scene::markChanged();
   p->mirrored = mirrored;
   p->onSrcRectChange();
 }
@@ -607,6 +735,7 @@ void Sprite::set_mirror_y(bool mirrored)
   guardDisposed();
   if (p->mirrored_y == mirrored)
     return;
+  Scene::markChanged();
   p->mirrored_y = mirrored;
   p->onSrcRectChange();
 }
@@ -614,6 +743,7 @@ void Sprite::set_mirror_y(bool mirrored)
 void Sprite::set_obscured(bool obscured)
 {
   guardDisposed();
+  Scene::markChanged();
   p->obscured = obscured;//p->onSrcRectChange();
 }
 
@@ -622,6 +752,7 @@ void Sprite::setBushDepth(int value)
   guardDisposed();
   if (p->bushDepth == value)
     return;
+  Scene::markChanged();
   p->bushDepth = value;
   p->recomputeBushDepth();
 }
@@ -629,6 +760,7 @@ void Sprite::setBushDepth(int value)
 void Sprite::setBlendType(int type)
 {
   guardDisposed();
+  Scene::markChanged();
   switch (type) {
   default :
   case BlendNormal :
@@ -663,6 +795,7 @@ void Sprite::set_reduce_speed(int speed)
 void Sprite::increase_width()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduced_width = p->bitmap->width();
   p->increase_width = true;
   p->update_reduce_width();
@@ -671,6 +804,7 @@ void Sprite::increase_width()
 void Sprite::increase_height()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduced_height = p->bitmap->height();
   p->increase_height = true;
   p->update_reduce_height();
@@ -679,6 +813,7 @@ void Sprite::increase_height()
 void Sprite::increase_width_height()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduced_width = p->bitmap->width();
   p->reduced_height = p->bitmap->height();
   p->increase_width = true;
@@ -690,18 +825,21 @@ void Sprite::increase_width_height()
 void Sprite::reduce_width()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduce_width = true;
 }
 
 void Sprite::reduce_height()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduce_height = true;
 }
 
 void Sprite::reduce_width_height()
 {
   guardDisposed();
+  Scene::markChanged();
   p->reduce_width = true;
   p->reduce_height = true;
 }
@@ -812,10 +950,13 @@ void Sprite::update()
 {
   guardDisposed();
   Flashable::update();
+  if (p->increase_width || p->reduce_width || p->increase_height || p->reduce_height)
+    Scene::markChanged();
   p->update_reduce_width();
   p->update_reduce_height();
   if (!p->wave.active)
     return;
+  Scene::markChanged();
   p->wave.phase += p->wave.speed / 180;
   p->wave.dirty = true;
 }
@@ -865,11 +1006,23 @@ void Sprite::draw()
     base = &shader;
   }
   glState.blendMode.pushSet(p->blendType);
-  p->bitmap->bindTex(*base);
-  if (p->wave.active)
-    p->wave.qArray.draw();
-  else
-    p->quad.draw();
+  // Bush depth is relative to the texture, which differs for these two
+  SpriteShader *bushShader = 0;
+  if (base == &shState->shaders().sprite)
+    bushShader = &shState->shaders().sprite;
+  const TEXFBO *page;
+  IntRect slot;
+  if (p->bitmap->isMega()) {
+    p->drawMega(*base, bushShader);
+  } else if (!p->wave.active && (page = p->bitmap->atlasPage(slot))) {
+    p->drawAtlas(*base, bushShader, *page, slot);
+  } else {
+    p->bitmap->bindTex(*base);
+    if (p->wave.active)
+      p->wave.qArray.draw();
+    else
+      p->quad.draw();
+  }
   glState.blendMode.pop();
 }
 
@@ -878,6 +1031,19 @@ void Sprite::onGeometryChange(const Scene::Geometry &geo)
   p->trans.setGlobalOffset(geo.offset());
   p->sceneRect.setSize(geo.rect.size());
   p->sceneOrig = geo.orig;
+  p->scenePos = geo.rect.pos();
+}
+
+void *Sprite::getPickData() const
+{
+  return p->pick.data;
+}
+
+void Sprite::setPickData(void *data)
+{
+  p->pick.data = data;
+  if (!data)
+    shState->graphics().pickIndex().remove(p->pick);
 }
 
 void Sprite::releaseResources() {
@@ -107,12 +107,17 @@ public:
   bool mouse_is_inside();
   bool mouse_is_inside_area(Rect *rect, bool state);
   bool mouse_is_above_color_found();
+  /* Sprites with pick data set are tracked by Graphics::pick(),
+   * which hands the data back when they're clicked */
+  void *getPickData() const;
+  void setPickData(void *data);
   void initDynAttribs();
   void onGeometryChange(const Scene::Geometry &);
 
 private:
   SpritePrivate *p;
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawSprite; }
   void releaseResources();
   const char *klassName() const { return "sprite"; }
   ABOUT_TO_ACCESS_DISP
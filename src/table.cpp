@@ -42,7 +42,96 @@ void Table::set(int16_t value, int x, int y, int z)
 {
   if (x < 0 || x >= xs ||  y < 0 || y >= ys ||  z < 0 || z >= zs) return;
   data[xs*ys*z + xs*y + x] = value;
+  notifyRegion(TableRegion(x, y, z, 1, 1, 1));
+}
+
+void Table::notifyRegion(const TableRegion &r)
+{
   modified();
+  regionModified(r);
+}
+
+bool Table::clipRegion(TableRegion &r) const
+{
+  if (r.x < 0) { r.w += r.x; r.x = 0; }
+  if (r.y < 0) { r.h += r.y; r.y = 0; }
+  if (r.z < 0) { r.d += r.z; r.z = 0; }
+  r.w = std::min(r.w, xs - r.x);
+  r.h = std::min(r.h, ys - r.y);
+  r.d = std::min(r.d, zs - r.z);
+  return !r.isEmpty();
+}
+
+bool Table::containsRegion(const TableRegion &r) const
+{
+  return r.x >= 0 && r.y >= 0 && r.z >= 0 &&
+         r.w >= 0 && r.h >= 0 && r.d >= 0 &&
+         r.x + r.w <= xs && r.y + r.h <= ys && r.z + r.d <= zs;
+}
+
+void Table::fill(const TableRegion &r, int16_t value)
+{
+  TableRegion c = r;
+  if (!clipRegion(c)) return;
+  for (int k = c.z; k < c.z + c.d; ++k)
+    for (int j = c.y; j < c.y + c.h; ++j) {
+      int16_t *row = &at(c.x, j, k);
+      std::fill(row, row + c.w, value);
+    }
+  notifyRegion(c);
+}
+/* Source and destination boxes are clipped together so that
+ * every copied cell keeps its relative offset */
+void Table::copyRegion(int dx, int dy, int dz, const Table &src, const TableRegion &sr)
+{
+  TableRegion s = sr;
+  int offX = dx - s.x, offY = dy - s.y, offZ = dz - s.z;
+  if (!src.clipRegion(s)) return;
+  TableRegion d(s.x + offX, s.y + offY, s.z + offZ, s.w, s.h, s.d);
+  if (!clipRegion(d)) return;
+  s = TableRegion(d.x - offX, d.y - offY, d.z - offZ, d.w, d.h, d.d);
+  std::vector<int16_t> buffer(s.cellCount());
+  src.readRegion(s, dataPtr(buffer));
+  writeRegion(d, dataPtr(buffer));
+}
+// Cells are packed x first, then y, then z
+void Table::readRegion(const TableRegion &r, int16_t *out) const
+{
+  if (!containsRegion(r))
+    throw Exception(Exception::ArgumentError, "Table: region out of bounds");
+  for (int k = r.z; k < r.z + r.d; ++k)
+    for (int j = r.y; j < r.y + r.h; ++j) {
+      memcpy(out, &at(r.x, j, k), sizeof(int16_t)*r.w);
+      out += r.w;
+    }
+}
+
+void Table::writeRegion(const TableRegion &r, const int16_t *in)
+{
+  if (!containsRegion(r))
+    throw Exception(Exception::ArgumentError, "Table: region out of bounds");
+  if (r.isEmpty()) return;
+  for (int k = r.z; k < r.z + r.d; ++k)
+    for (int j = r.y; j < r.y + r.h; ++j) {
+      memcpy(&at(r.x, j, k), in, sizeof(int16_t)*r.w);
+      in += r.w;
+    }
+  notifyRegion(r);
+}
+
+void Table::addRegion(const TableRegion &r, int delta, int min, int max)
+{
+  TableRegion c = r;
+  if (!clipRegion(c)) return;
+  min = std::max(min, -32768);
+  max = std::min(max, 32767);
+  for (int k = c.z; k < c.z + c.d; ++k)
+    for (int j = c.y; j < c.y + c.h; ++j) {
+      int16_t *row = &at(c.x, j, k);
+      for (int i = 0; i < c.w; ++i)
+        row[i] = clamp<int>(row[i] + delta, min, max);
+    }
+  notifyRegion(c);
 }
 
 void Table::resize(int x, int y, int z)
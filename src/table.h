@@ -28,6 +28,21 @@
 #include <sigc++/signal.h>
 #include <vector>
 
+/* Box of cells spanning [x, x+w) * [y, y+h) * [z, z+d) */
+struct TableRegion
+{
+  int x, y, z, w, h, d;
+
+  TableRegion()
+  : x(0), y(0), z(0), w(0), h(0), d(0) {}
+
+  TableRegion(int x, int y, int z, int w, int h, int d)
+  : x(x), y(y), z(z), w(w), h(h), d(d) {}
+
+  bool isEmpty() const { return w <= 0 || h <= 0 || d <= 0; }
+  int cellCount() const { return isEmpty() ? 0 : w*h*d; }
+};
+
 class Table : public Serializable
 {
 public:
@@ -43,6 +58,15 @@ public:
   void resize(int x, int y, int z);
   void resize(int x, int y);
   void resize(int x);
+  /* Region operations; each one emits a single change notification */
+  void fill(const TableRegion &r, int16_t value);
+  void copyRegion(int dx, int dy, int dz, const Table &src, const TableRegion &sr);
+  void readRegion(const TableRegion &r, int16_t *out) const;
+  void writeRegion(const TableRegion &r, const int16_t *in);
+  void addRegion(const TableRegion &r, int delta, int min, int max);
+  /* Clips 'r' against the table bounds, returns false if nothing is left */
+  bool clipRegion(TableRegion &r) const;
+  bool containsRegion(const TableRegion &r) const;
   int serialSize() const;
   void serialize(char *buffer) const;
   static Table *deserialize(const char *data, int len);
@@ -58,8 +82,12 @@ public:
   }
 
   sigc::signal<void> modified;
+  /* Emitted right after 'modified' with the box of changed cells */
+  sigc::signal<void, const TableRegion&> regionModified;
 
 private:
+  void notifyRegion(const TableRegion &r);
+
   int xs, ys, zs;
   std::vector<int16_t> data;
 };
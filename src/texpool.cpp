@@ -24,99 +24,238 @@
 #include "sharedstate.h"
 #include "glstate.h"
 #include "boost-hash.h"
+#include "intrulist.h"
 #include "debugwriter.h"
-#include <list>
+#include <vector>
+#include <algorithm>
 #include <utility>
 #include <assert.h>
 #include <string.h>
 
 typedef std::pair<uint16_t, uint16_t> Size;
 
-static uint32_t byteCount(Size &s)
+static uint64_t byteCount(int width, int height)
 {
-  return s.first * s.second * 4;
+  return (uint64_t) width * height * 4;
 }
 
-struct CacheNode
+/* Rounds a dimension up to its size class. Steps grow with
+ * the size so big textures don't waste too much memory */
+static int classDim(int value)
+{
+  int step = value <= 256 ? 32 : value <= 1024 ? 64 : 128;
+  return (value + step - 1) / step * step;
+}
+
+static Size sizeClass(int width, int height)
+{
+  return Size(classDim(width), classDim(height));
+}
+
+struct PoolNode
 {
   TEXFBO obj;
-  std::list<TEXFBO>::iterator prioIter;
-  bool operator==(const CacheNode &o) const
-  {
-    return obj == o.obj;
-  }
+  // Position in the release order, most recent first
+  IntruListLink<PoolNode> lruLink;
+  // Position among cached textures of the exact same size
+  IntruListLink<PoolNode> sizeLink;
+  // Position among cached textures of the same size class
+  IntruListLink<PoolNode> classLink;
+
+  PoolNode(const TEXFBO &obj)
+  : obj(obj), lruLink(this), sizeLink(this), classLink(this)
+  {}
+};
+
+typedef IntruList<PoolNode> NodeList;
+
+/* Atlas pages are filled with shelves: rows whose height is set
+ * by the first slot placed in them, and which are filled from
+ * left to right. A shelf is only reused once all its slots
+ * were freed, a page gets released once it's empty */
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_MAX_PAGES 4
+// Bigger textures gain little from sharing a page
+#define ATLAS_MAX_SLOT 256
+// Shelf heights are rounded up to this, so similar sizes share them
+#define ATLAS_SHELF_STEP 8
+
+struct AtlasShelf
+{
+  int y, h;
+  // Start of the free space
+  int x;
+  int used;
 };
 
-typedef std::list<CacheNode> CNodeList;
+struct AtlasPage
+{
+  TEXFBO tex;
+  std::vector<AtlasShelf> shelves;
+  // Start of the space no shelf claimed yet
+  int nextY;
+  int used;
+
+  AtlasPage() : nextY(0), used(0) {}
+};
 
 struct TexPoolPrivate
 {
-  /* Contains all cached TexFBOs, grouped by size */
-  BoostHash<Size, CNodeList> poolHash;
-  /* Contains all cached TexFBOs, sorted by release time */
-  std::list<TEXFBO> priorityQueue;
+  /* Cached nodes grouped by exact size and by size class */
+  BoostHash<Size, NodeList*> sizeBuckets;
+  BoostHash<Size, NodeList*> classBuckets;
+  /* Contains all cached nodes, sorted by release time */
+  NodeList lru;
   /* Maximal allowed cache memory */
-  const uint32_t maxMemSize;
-  /* Current amound of memory consumed by the cache */
-  uint32_t memSize;
-  /* Current amount of TexFBOs cached */
-  uint16_t objCount;
+  uint64_t maxMemSize;
+  /* Current amount of memory consumed by the cache */
+  uint64_t memSize;
+  TexPool::Stats stats;
+  AtlasPage atlas[ATLAS_MAX_PAGES];
+  int atlasPageSize;
   /* Has this pool been disabled? */
   bool disabled;
-  TexPoolPrivate(uint32_t maxMemSize)
-      : maxMemSize(maxMemSize),
-        memSize(0),
-        objCount(0),
-        disabled(false)
-  {}
+
+  TexPoolPrivate(uint64_t maxMemSize)
+  : maxMemSize(maxMemSize),
+    memSize(0),
+    atlasPageSize(0),
+    disabled(false)
+  {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  ~TexPoolPrivate()
+  {
+    BoostHash<Size, NodeList*>::const_iterator iter;
+    for (iter = sizeBuckets.cbegin(); iter != sizeBuckets.cend(); ++iter)
+      delete iter->second;
+    for (iter = classBuckets.cbegin(); iter != classBuckets.cend(); ++iter)
+      delete iter->second;
+  }
+
+  static NodeList &bucket(BoostHash<Size, NodeList*> &hash, const Size &key)
+  {
+    NodeList *&list = hash[key];
+    if (!list)
+      list = new NodeList;
+    return *list;
+  }
+
+  void link(PoolNode *node)
+  {
+    const TEXFBO &obj = node->obj;
+    lru.prepend(node->lruLink);
+    bucket(sizeBuckets, Size(obj.width, obj.height)).append(node->sizeLink);
+    bucket(classBuckets, sizeClass(obj.width, obj.height)).append(node->classLink);
+    memSize += byteCount(obj.width, obj.height);
+    ++stats.cached;
+  }
+
+  // Takes the node out of the cache and hands back its texture
+  TEXFBO unlink(PoolNode *node)
+  {
+    TEXFBO obj = node->obj;
+    lru.remove(node->lruLink);
+    sizeBuckets[Size(obj.width, obj.height)]->remove(node->sizeLink);
+    classBuckets[sizeClass(obj.width, obj.height)]->remove(node->classLink);
+    memSize -= byteCount(obj.width, obj.height);
+    --stats.cached;
+    delete node;
+    return obj;
+  }
+
+  bool placeInPage(int index, int innerW, int innerH, AtlasSlot &slot)
+  {
+    AtlasPage &page = atlas[index];
+    int width = innerW + ATLAS_GUTTER * 2;
+    int height = innerH + ATLAS_GUTTER * 2;
+    int shelfH = (height + ATLAS_SHELF_STEP - 1) / ATLAS_SHELF_STEP * ATLAS_SHELF_STEP;
+    int found = -1;
+    for (size_t i = 0; i < page.shelves.size(); ++i) {
+      AtlasShelf &s = page.shelves[i];
+      // Don't waste tall shelves on short slots
+      if (s.h < height || s.h > shelfH * 2 || s.x + width > atlasPageSize)
+        continue;
+      if (found < 0 || s.h < page.shelves[found].h)
+        found = i;
+    }
+    if (found < 0) {
+      if (page.nextY + shelfH > atlasPageSize)
+        return false;
+      AtlasShelf s = { page.nextY, shelfH, 0, 0 };
+      page.nextY += shelfH;
+      page.shelves.push_back(s);
+      found = page.shelves.size() - 1;
+    }
+    AtlasShelf &s = page.shelves[found];
+    slot.page = &page.tex;
+    slot.rect = IntRect(s.x + ATLAS_GUTTER, s.y + ATLAS_GUTTER, innerW, innerH);
+    slot.pageIndex = index;
+    slot.shelf = found;
+    s.x += width;
+    ++s.used;
+    ++page.used;
+    return true;
+  }
+
+  // Deletes least recently released textures until 'incoming' more bytes fit
+  void evict(uint64_t incoming)
+  {
+    while (memSize + incoming > maxMemSize && !lru.isEmpty()) {
+      TEXFBO obj = unlink(lru.tail());
+      TEXFBO::fini(obj);
+      ++stats.evictions;
+    }
+  }
 };
 
-TexPool::TexPool(uint32_t maxMemSize)
+TexPool::TexPool(uint64_t maxMemSize)
 {
   p = new TexPoolPrivate(maxMemSize);
 }
 
 TexPool::~TexPool()
 {
-  std::list<TEXFBO>::iterator iter;
-  for (iter = p->priorityQueue.begin();
-       iter != p->priorityQueue.end();
-       ++iter)
-  {
-    TEXFBO obj = *iter;
+  for (int i = 0; i < ATLAS_MAX_PAGES; ++i)
+    if (p->atlas[i].tex.tex != TEX::ID(0))
+      TEXFBO::fini(p->atlas[i].tex);
+  while (!p->lru.isEmpty()) {
+    TEXFBO obj = p->unlink(p->lru.tail());
     TEXFBO::fini(obj);
-    --p->objCount;
   }
-  assert(p->objCount == 0);
+  assert(p->memSize == 0);
   delete p;
 }
 
 TEXFBO TexPool::request(int width, int height)
 {
-  CacheNode cnode;
-  Size size(width, height);
   /* See if we can statisfy request from cache */
-  CNodeList &bucket = p->poolHash[size];
-  if (!bucket.empty()) {
-    /* Found one! */
-    cnode = bucket.back();
-    bucket.pop_back();
-    p->priorityQueue.erase(cnode.prioIter);
-    p->memSize -= byteCount(size);
-    --p->objCount;
-//		Debug() << "TexPool: <?+> (" << width << height << ")";
-    return cnode.obj;
+  NodeList *exact = p->sizeBuckets.value(Size(width, height));
+  if (exact && !exact->isEmpty()) {
+    ++p->stats.hits;
+    return p->unlink(exact->tail());
   }
   int maxSize = glState.caps.maxTexSize;
   if (width > maxSize + 800 || height > maxSize + 800)
     throw Exception(Exception::HiddenChestError,
       "Texture dimensions [%d, %d] exceed hardware capabilities", width, height);
+  /* A near miss still saves creating the objects and
+   * linking the FBO, only the storage gets reallocated */
+  NodeList *similar = p->classBuckets.value(sizeClass(width, height));
+  if (similar && !similar->isEmpty()) {
+    ++p->stats.nearHits;
+    TEXFBO obj = p->unlink(similar->tail());
+    TEXFBO::allocEmpty(obj, width, height);
+    return obj;
+  }
   /* Nope, create it instead */
-  TEXFBO::init(cnode.obj);
-  TEXFBO::allocEmpty(cnode.obj, width, height);
-  TEXFBO::linkFBO(cnode.obj);
-//	Debug() << "TexPool: <?-> (" << width << height << ")";
-  return cnode.obj;
+  ++p->stats.misses;
+  TEXFBO obj;
+  TEXFBO::init(obj);
+  TEXFBO::allocEmpty(obj, width, height);
+  TEXFBO::linkFBO(obj);
+  return obj;
 }
 
 void TexPool::release(TEXFBO &obj)
@@ -125,46 +264,75 @@ void TexPool::release(TEXFBO &obj)
     TEXFBO::fini(obj);
     return;
   }
-  if (p->disabled) {
-    /* If we're disabled, delete without caching */
-// Debug() << "TexPool: <!#> (" << obj.width << obj.height << ")";
+  uint64_t bytes = byteCount(obj.width, obj.height);
+  /* If we're disabled or the object alone is over budget, delete without caching */
+  if (p->disabled || bytes > p->maxMemSize) {
     TEXFBO::fini(obj);
     return;
   }
-  Size size(obj.width, obj.height);
-  uint32_t newMemSize = p->memSize + byteCount(size);
   /* If caching this object would spill over the allowed memory budget,
    * delete least used objects until we're good again */
-  while (newMemSize > p->maxMemSize) {
-    if (p->objCount == 0) break;
-// Debug() << "TexPool: <!~> Size:" << p->memSize;
-    /* Retrieve object with lowest priority for deletion */
-    CacheNode last;
-    last.obj = p->priorityQueue.back();
-    Size removedSize(last.obj.width, last.obj.height);
-    CNodeList &bucket = p->poolHash[removedSize];
-    std::list<CacheNode>::iterator toRemove = std::find(bucket.begin(), bucket.end(), last);
-    assert(toRemove != bucket.end());
-    bucket.erase(toRemove);
-    p->priorityQueue.pop_back();
-    TEXFBO::fini(last.obj);
-    newMemSize -= byteCount(removedSize);
-    --p->objCount;
-// Debug() << "TexPool: <!-> (" << last.obj.width << last.obj.height << ")";
-  }
-  p->memSize = newMemSize;
-  /* Retain object */
-  p->priorityQueue.push_front(obj);
-  CacheNode cnode;
-  cnode.obj = obj;
-  cnode.prioIter = p->priorityQueue.begin();
-  CNodeList &bucket = p->poolHash[size];
-  bucket.push_back(cnode);
-  ++p->objCount;
-// Debug() << "TexPool: <!+> (" << obj.width << obj.height << ") Current size:" << p->memSize;
+  p->evict(bytes);
+  p->link(new PoolNode(obj));
 }
 
 void TexPool::disable()
 {
   p->disabled = true;
 }
+
+uint64_t TexPool::getBudget() const
+{
+  return p->maxMemSize;
+}
+
+void TexPool::setBudget(uint64_t bytes)
+{
+  p->maxMemSize = bytes;
+  p->evict(0);
+}
+
+TexPool::Stats TexPool::getStats() const
+{
+  Stats stats = p->stats;
+  stats.bytes = p->memSize;
+  return stats;
+}
+
+bool TexPool::atlasAlloc(int width, int height, AtlasSlot &slot)
+{
+  if (width <= 0 || height <= 0 || width > ATLAS_MAX_SLOT || height > ATLAS_MAX_SLOT)
+    return false;
+  if (!p->atlasPageSize)
+    p->atlasPageSize = std::min(ATLAS_PAGE_SIZE, glState.caps.maxTexSize);
+  for (int i = 0; i < ATLAS_MAX_PAGES; ++i) {
+    if (!p->placeInPage(i, width, height, slot))
+      continue;
+    AtlasPage &page = p->atlas[i];
+    if (page.tex.tex == TEX::ID(0)) {
+      TEXFBO::init(page.tex);
+      TEXFBO::allocEmpty(page.tex, p->atlasPageSize, p->atlasPageSize);
+      TEXFBO::linkFBO(page.tex);
+    }
+    return true;
+  }
+  return false;
+}
+
+void TexPool::atlasFree(AtlasSlot &slot)
+{
+  if (slot.pageIndex < 0)
+    return;
+  AtlasPage &page = p->atlas[slot.pageIndex];
+  AtlasShelf &shelf = page.shelves[slot.shelf];
+  if (--shelf.used == 0)
+    shelf.x = 0;
+  if (--page.used == 0) {
+    // Pages are too big to keep around in the cache
+    TEXFBO::fini(page.tex);
+    TEXFBO::clear(page.tex);
+    page.shelves.clear();
+    page.nextY = 0;
+  }
+  slot = AtlasSlot();
+}
@@ -23,17 +23,59 @@
 #define TEXPOOL_H
 
 #include "gl-util.h"
+#include "etc-internal.h"
+#include <stdint.h>
 
 struct TexPoolPrivate;
 
+/* Free border around every atlas slot, its owner fills it with
+ * copies of the edge pixels so scaled or rotated draws filter
+ * in those instead of the neighbouring slot */
+#define ATLAS_GUTTER 1
+
+// Area handed out from one of the shared atlas pages
+struct AtlasSlot
+{
+  TEXFBO *page;
+  IntRect rect;
+  int pageIndex;
+  int shelf;
+
+  AtlasSlot() : page(0), pageIndex(-1), shelf(-1) {}
+};
+
 class TexPool
 {
 public:
-  TexPool(uint32_t maxMemSize = 20000000 /* 20 MB */);
+  struct Stats
+  {
+    // Requests served with a cached texture of the exact size
+    uint64_t hits;
+    // Requests that recycled a cached texture of the same size class
+    uint64_t nearHits;
+    // Requests that had to create a new texture
+    uint64_t misses;
+    // Cached textures deleted to stay within the budget
+    uint64_t evictions;
+    // Memory held by cached textures and their count
+    uint64_t bytes;
+    uint64_t cached;
+  };
+
+  TexPool(uint64_t maxMemSize = 20000000 /* 20 MB */);
   ~TexPool();
   TEXFBO request(int width, int height);
   void release(TEXFBO &obj);
   void disable();
+  uint64_t getBudget() const;
+  // Evicts right away if the cache is over the new budget
+  void setBudget(uint64_t bytes);
+  Stats getStats() const;
+  /* Packs small textures into a few big shared pages, so things
+   * drawn from them can share a texture binding. Fails when the
+   * size is too big for the atlas or all pages are full */
+  bool atlasAlloc(int width, int height, AtlasSlot &slot);
+  void atlasFree(AtlasSlot &slot);
 
 private:
   TexPoolPrivate *p;
@@ -266,7 +266,7 @@ static void doBlit(Bitmap *bm, const IntRect &src, const Vec2i &dst)
 	if (!SDL_IntersectRect(&_src, &bmr, &_src))
 		return;
 
-	GLMeta::blitRectangle(_src, _dst);
+	bm->blitRegion(_src, _dst);
 }
 
 void build(TEXFBO &tf, Bitmap *bitmaps[BM_COUNT])
@@ -292,7 +292,6 @@ void build(TEXFBO &tf, Bitmap *bitmaps[BM_COUNT])
 #define EXEC_BLITS(part) \
 	if (!nullOrDisposed(bm = bitmaps[BM_##part])) \
 	{ \
-		GLMeta::blitSource(bm->getGLTypes()); \
 		for (size_t i = 0; i < blits##part##N; ++i) \
 		{\
 			const IntRect &src = blits##part[i].src; \
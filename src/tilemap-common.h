@@ -59,6 +59,29 @@ tableGetWrapped(const Table &t, int x, int y, int z = 0)
                z);
 }
 
+/* Check if the span [start, start+len) of a table axis with
+ * 'size' cells overlaps the wrapped map viewport span
+ * [vStart, vStart+vLen); 'start' is expected to be clipped */
+static inline bool
+wrappedSpanOverlaps(int start, int len, int vStart, int vLen, int size)
+{
+  if (size <= 0 || vLen >= size)
+    return true;
+  vStart = wrap(vStart, size);
+  if (start < vStart + vLen && vStart < start + len)
+    return true;
+  /* Part of the viewport that wrapped around to the table start */
+  return start < vStart + vLen - size;
+}
+
+/* Check if a modified table region is visible in the map viewport */
+static inline bool
+tableRegionInView(const Table &t, const TableRegion &r, const IntRect &view)
+{
+  return wrappedSpanOverlaps(r.x, r.w, view.x, view.w, t.xSize()) &&
+         wrappedSpanOverlaps(r.y, r.h, view.y, view.h, t.ySize());
+}
+
 /* Calculate the tile x/y on which this pixel x/y lies */
 static inline Vec2i
 getTilePos(const Vec2i &pixelPos, int tile_size)
@@ -173,6 +196,7 @@ struct FlashMap
 		shader.applyViewportProj();
 		shader.setAlpha(alpha);
 		shader.setTranslation(trans);
+		++GLState::counters.draws;
 		gl.DrawElements(GL_TRIANGLES, count * 6, _GL_INDEX_TYPE, 0);
 		glState.blendMode.pop();
 		GLMeta::vaoUnbind(vao);
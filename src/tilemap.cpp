@@ -171,6 +171,7 @@ struct GroundLayer : public ViewportElement
   GroundLayer(TilemapPrivate *p, Viewport *viewport);
   void updateVboCount();
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawTilemap; }
   void drawInt();
   void onGeometryChange(const Scene::Geometry &geo);
   ABOUT_TO_ACCESS_NOOP
@@ -192,6 +193,7 @@ struct ZLayer : public ViewportElement
   ZLayer(TilemapPrivate *p, Viewport *viewport);
   void setIndex(int value);
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawTilemap; }
   void drawInt();
   static int calculateZ(TilemapPrivate *p, int index);
   void initUpdateZ();
@@ -368,8 +370,6 @@ struct TilemapPrivate
     for (int i = 0; i < autotileCount; ++i) {
       if (nullOrDisposed(autotiles[i]))
         continue;
-      if (autotiles[i]->megaSurface())
-        continue;
       usableATs.push_back(i);
       if (autotiles[i]->width() > autotileW)
         animatedATs.push_back(i);
@@ -396,6 +396,15 @@ struct TilemapPrivate
   void invalidateBuffers()
   {
     buffersDirty = true;
+    Scene::markChanged();
+  }
+  // Only tiles inside the map viewport end up in the buffers
+  void onMapDataRegion(const TableRegion &r)
+  {
+    if (buffersDirty || !mapData)
+      return;
+    if (tableRegionInView(*mapData, r, IntRect(viewpPos, Vec2i(vw, vh))))
+      invalidateBuffers();
   }
   // Checks for the minimum amount of data needed to display
   bool verifyResources()
@@ -432,67 +441,26 @@ struct TilemapPrivate
       Bitmap *autotile = autotiles[atInd];
       int blitW = std::min(autotile->width(), atAreaW);
       int blitH = std::min(autotile->height(), atAreaH);
-      GLMeta::blitSource(autotile->getGLTypes());
       if (blitW <= autotileW && tiles.animated) {
         // Static autotile
         for (int j = 0; j < 4; ++j)
-          GLMeta::blitRectangle(IntRect(0, 0, blitW, blitH),
+          autotile->blitRegion(IntRect(0, 0, blitW, blitH),
             Vec2i(autotileW*j, atInd*autotileH));
       } else {
       // Animated autotile
-        GLMeta::blitRectangle(IntRect(0, 0, blitW, blitH),
+        autotile->blitRegion(IntRect(0, 0, blitW, blitH),
           Vec2i(0, atInd*autotileH));
       }
     }
     GLMeta::blitEnd();
-    // Blit tileset
-    if (tileset->megaSurface()) {
-      // Mega surface tileset
-      SDL_Surface *tsSurf = tileset->megaSurface();
-      if (shState->config().subImageFix) {
-        // Implementation for broken GL drivers
-        FBO::bind(atlas.gl.fbo);
-        glState.blend.pushSet(false);
-        glState.viewport.pushSet(IntRect(0, 0, atlas.size.x, atlas.size.y));
-        SimpleShader &shader = shState->shaders().simple;
-        shader.bind();
-        shader.applyViewportProj();
-        shader.setTranslation(Vec2i());
-        Quad &quad = shState->gpQuad();
-        for (size_t i = 0; i < blits.size(); ++i) {
-          const TileAtlas::Blit &blitOp = blits[i];
-          Vec2i texSize;
-          shState->ensureTexSize(tsLaneW, blitOp.h, texSize);
-          shState->bindTex();
-          GLMeta::subRectImageUpload(tsSurf->w, blitOp.src.x, blitOp.src.y,
-                                     0, 0, tsLaneW, blitOp.h, tsSurf, GL_RGBA);
-          shader.setTexSize(texSize);
-          quad.setTexRect(FloatRect(0, 0, tsLaneW, blitOp.h));
-          quad.setPosRect(FloatRect(blitOp.dst.x, blitOp.dst.y, tsLaneW, blitOp.h));
-          quad.draw();
-        }
-        GLMeta::subRectImageEnd();
-        glState.viewport.pop();
-        glState.blend.pop();
-      } else {// Clean implementation
-        TEX::bind(atlas.gl.tex);
-        for (size_t i = 0; i < blits.size(); ++i) {
-          const TileAtlas::Blit &blitOp = blits[i];
-          GLMeta::subRectImageUpload(tsSurf->w, blitOp.src.x, blitOp.src.y,
-             blitOp.dst.x, blitOp.dst.y, tsLaneW, blitOp.h, tsSurf, GL_RGBA);
-        }
-        GLMeta::subRectImageEnd();
-      }
-    } else {
-      // Regular tileset
-      GLMeta::blitBegin(atlas.gl);
-      GLMeta::blitSource(tileset->getGLTypes());
-      for (size_t i = 0; i < blits.size(); ++i) {
-        const TileAtlas::Blit &blitOp = blits[i];
-        GLMeta::blitRectangle(IntRect(blitOp.src.x, blitOp.src.y, tsLaneW, blitOp.h), blitOp.dst);
-      }
-      GLMeta::blitEnd();
+    /* Blit tileset. Mega surface tilesets are made of several
+     * textures, blitRegion() spreads the lanes over them */
+    GLMeta::blitBegin(atlas.gl);
+    for (size_t i = 0; i < blits.size(); ++i) {
+      const TileAtlas::Blit &blitOp = blits[i];
+      tileset->blitRegion(IntRect(blitOp.src.x, blitOp.src.y, tsLaneW, blitOp.h), blitOp.dst);
     }
+    GLMeta::blitEnd();
   }
 
   int samplePriority(int tileInd)
@@ -740,6 +708,7 @@ struct TilemapPrivate
       atlasSizeDirty = false;
     }
     if (atlasDirty) {
+      FrameProfiler::Scope timer(FrameProfiler::TilemapRebuild);
       buildAtlas();
       atlasDirty = false;
     }
@@ -748,6 +717,7 @@ struct TilemapPrivate
       mapViewportDirty = false;
     }
     if (buffersDirty) {
+      FrameProfiler::Scope timer(FrameProfiler::TilemapRebuild);
       buildQuadArray();
       uploadBuffers();
       updateSceneElements();
@@ -792,6 +762,7 @@ void GroundLayer::draw()
 
 void GroundLayer::drawInt()
 {
+  ++GLState::counters.draws;
   gl.DrawElements(GL_TRIANGLES, vboCount, _GL_INDEX_TYPE, (GLvoid*) 0);
 }
 
@@ -834,6 +805,7 @@ void ZLayer::draw()
 
 void ZLayer::drawInt()
 {
+  ++GLState::counters.draws;
   gl.DrawElements(GL_TRIANGLES, vboBatchCount, _GL_INDEX_TYPE, (GLvoid*) vboOffset);
 }
 
@@ -900,6 +872,7 @@ void Tilemap::update()
   guardDisposed();
   if (!p->tilemapReady)
     return;
+  Scene::markChanged();
   // Animate flash
   if (++p->flashAlphaIdx >= flashAlphaN)
     p->flashAlphaIdx = 0;
@@ -941,6 +914,7 @@ void Tilemap::setTileset(Bitmap *value)
   guardDisposed();
   if (p->tileset == value)
     return;
+  Scene::markChanged();
   p->tileset = value;
   if (!value)
     return;
@@ -956,18 +930,20 @@ void Tilemap::setMapData(Table *value)
   guardDisposed();
   if (p->mapData == value)
     return;
+  Scene::markChanged();
   p->mapData = value;
   if (!value)
     return;
   p->invalidateBuffers();
   p->mapDataCon.disconnect();
-  p->mapDataCon = value->modified.connect
-    (sigc::mem_fun(p, &TilemapPrivate::invalidateBuffers));
+  p->mapDataCon = value->regionModified.connect
+    (sigc::mem_fun(p, &TilemapPrivate::onMapDataRegion));
 }
 
 void Tilemap::setFlashData(Table *value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->flashMap.setData(value);
 }
 
@@ -976,6 +952,7 @@ void Tilemap::setPriorities(Table *value)
   guardDisposed();
   if (p->priorities == value)
     return;
+  Scene::markChanged();
   p->priorities = value;
   if (!value)
     return;
@@ -990,6 +967,7 @@ void Tilemap::setVisible(bool value)
   guardDisposed();
   if (p->visible == value)
     return;
+  Scene::markChanged();
   p->visible = value;
   if (!p->tilemapReady)
     return;
@@ -1003,6 +981,7 @@ void Tilemap::setOX(int value)
   guardDisposed();
   if (p->origin.x == value)
     return;
+  Scene::markChanged();
   p->origin.x = value;
   p->mapViewportDirty = true;
 }
@@ -1012,6 +991,7 @@ void Tilemap::setOY(int value)
   guardDisposed();
   if (p->origin.y == value)
     return;
+  Scene::markChanged();
   p->origin.y = value;
   p->zOrderDirty = true;
   p->mapViewportDirty = true;
@@ -1019,12 +999,14 @@ void Tilemap::setOY(int value)
 
 void Tilemap::set_tile_zoom(int value)
 {
+  Scene::markChanged();
   p->tile_zoom = value;
   p->tsize = value * 32 / 100;
 }
 
 void Tilemap::set_z(int value)
 {
+  Scene::markChanged();
   p->set_z(value);
 }
 
@@ -1035,6 +1017,7 @@ int Tilemap::get_z()
 
 void Tilemap::set_autotiles_speed(int value)
 {
+  Scene::markChanged();
   p->autotiles_speed = clamp(1, value, 4);
 }
 
@@ -94,6 +94,11 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
       p->drawAbove();
       p->drawFlashLayer();
     }
+
+    FrameProfiler::Phase profilePhase() const
+    {
+      return FrameProfiler::DrawTilemap;
+    }
     ABOUT_TO_ACCESS_NOOP
   };
 
@@ -149,6 +154,18 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
   void invalidateBuffers()
   {
     buffersDirty = true;
+    Scene::markChanged();
+  }
+  /* Autotile and table tile shapes depend on neighbouring
+   * cells, so the region is grown by one tile on each side */
+  void onMapDataRegion(const TableRegion &r)
+  {
+    if (buffersDirty || !mapData)
+      return;
+    TableRegion grown(r.x - 1, r.y - 1, r.z, r.w + 2, r.h + 2, r.d);
+    mapData->clipRegion(grown);
+    if (tableRegionInView(*mapData, grown, mapViewp))
+      invalidateBuffers();
   }
 
   void rebuildAtlas()
@@ -211,6 +228,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
     if (!mapData)
       return;
     if (atlasDirty) {
+      FrameProfiler::Scope timer(FrameProfiler::TilemapRebuild);
       rebuildAtlas();
       atlasDirty = false;
     }
@@ -219,6 +237,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
       mapViewportDirty = false;
     }
     if (buffersDirty) {
+      FrameProfiler::Scope timer(FrameProfiler::TilemapRebuild);
       rebuildBuffers();
       buffersDirty = false;
     }
@@ -233,6 +252,11 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
   }
 
   /* SceneElement */
+  FrameProfiler::Phase profilePhase() const
+  {
+    return FrameProfiler::DrawTilemap;
+  }
+
   void draw()
   {
     drawGround();
@@ -258,6 +282,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
     shader->setTranslation(dispPos);
     TEX::bind(atlas.tex);
     GLMeta::vaoBind(vao);
+    ++GLState::counters.draws;
     gl.DrawElements(GL_TRIANGLES, groundQuads*6, _GL_INDEX_TYPE, 0);
     GLMeta::vaoUnbind(vao);
   }
@@ -272,6 +297,7 @@ struct TilemapVXPrivate : public ViewportElement, TileAtlasVX::Reader
     shader.setTranslation(dispPos);
     TEX::bind(atlas.tex);
     GLMeta::vaoBind(vao);
+    ++GLState::counters.draws;
     gl.DrawElements(GL_TRIANGLES, aboveQuads*6, _GL_INDEX_TYPE,
       (GLvoid*) (groundQuads*6*sizeof(index_t)));
     GLMeta::vaoUnbind(vao);
@@ -340,6 +366,7 @@ TilemapVX::~TilemapVX()
 void TilemapVX::update()
 {
   guardDisposed();
+  Scene::markChanged();
   // Animate tiles
   if (++p->frameIdx >= 30*3*4) p->frameIdx = 0;
   const uint8_t aniIndicesA[3*4] =
@@ -388,16 +415,18 @@ void TilemapVX::setMapData(Table *value)
 {
   guardDisposed();
   if (p->mapData == value) return;
+  Scene::markChanged();
   p->mapData = value;
   p->buffersDirty = true;
   p->mapDataCon.disconnect();
-  p->mapDataCon = value->modified.connect
-    (sigc::mem_fun(p, &TilemapVXPrivate::invalidateBuffers));
+  p->mapDataCon = value->regionModified.connect
+    (sigc::mem_fun(p, &TilemapVXPrivate::onMapDataRegion));
 }
 
 void TilemapVX::setFlashData(Table *value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->flashMap.setData(value);
 }
 
@@ -405,6 +434,7 @@ void TilemapVX::setFlags(Table *value)
 {
   guardDisposed();
   if (p->flags == value) return;
+  Scene::markChanged();
   p->flags = value;
   p->buffersDirty = true;
   p->flagsCon.disconnect();
@@ -415,6 +445,7 @@ void TilemapVX::setFlags(Table *value)
 void TilemapVX::setVisible(bool value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->setVisible(value);
   p->above.setVisible(value);
 }
@@ -423,6 +454,7 @@ void TilemapVX::setOX(int value)
 {
   guardDisposed();
   if (p->origin.x == value) return;
+  Scene::markChanged();
   p->origin.x = value;
   p->mapViewportDirty = true;
 }
@@ -431,18 +463,21 @@ void TilemapVX::setOY(int value)
 {
   guardDisposed();
   if (p->origin.y == value) return;
+  Scene::markChanged();
   p->origin.y = value;
   p->mapViewportDirty = true;
 }
 
 void TilemapVX::set_tile_zoom(int value)
 {
+  Scene::markChanged();
   p->tile_zoom = value;
   p->tsize = value * 32 / 100;
 }
 
 void TilemapVX::set_autotiles_speed(int value)
 {
+  Scene::markChanged();
   p->autotiles_speed = clamp(1, value, 4);
 }
 
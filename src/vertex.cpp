@@ -53,6 +53,14 @@ static const VertexAttribute VertexAttribs[] =
 	{ Shader::TexCoord, 2, GL_FLOAT, o(Vertex, texPos) }
 };
 
+static const VertexAttribute ShapeVertexAttribs[] =
+{
+	{ Shader::Color,    4, GL_FLOAT, o(ShapeVertex, color)  },
+	{ Shader::Position, 2, GL_FLOAT, o(ShapeVertex, pos)    },
+	{ Shader::TexCoord, 2, GL_FLOAT, o(ShapeVertex, texPos) },
+	{ Shader::Shape,    4, GL_FLOAT, o(ShapeVertex, shape)  }
+};
+
 #define DEF_TRAITS(VertType) \
 	template<> \
 	const VertexAttribute *VertexTraits<VertType>::attr = VertType##Attribs; \
@@ -62,3 +70,4 @@ static const VertexAttribute VertexAttribs[] =
 DEF_TRAITS(SVertex);
 DEF_TRAITS(CVertex);
 DEF_TRAITS(Vertex);
+DEF_TRAITS(ShapeVertex);
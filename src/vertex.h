@@ -47,6 +47,16 @@ struct Vertex
   Vertex();
 };
 
+/* Shape Vertex, texPos is relative to the shape's center
+ * and shape holds its type, radius, angle and sides */
+struct ShapeVertex
+{
+  Vec2 pos;
+  Vec2 texPos;
+  Vec4 color;
+  Vec4 shape;
+};
+
 struct VertexAttribute
 {
   Shader::Attribute index;
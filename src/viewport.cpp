@@ -129,6 +129,7 @@ Rect& Viewport::getRect() const
 void Viewport::setRect(Rect& rect)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->rect = rect;
 }
 
@@ -141,6 +142,7 @@ int Viewport::getX() const
 void Viewport::setX(int nx)
 {
   guardDisposed();
+  Scene::markChanged();
   p->rect->setX(nx);
 }
 
@@ -153,6 +155,7 @@ int Viewport::getY() const
 void Viewport::setY(int ny)
 {
   guardDisposed();
+  Scene::markChanged();
   p->rect->setY(ny);
 }
 
@@ -165,6 +168,7 @@ int Viewport::getWidth() const
 void Viewport::setWidth(int width)
 {
   guardDisposed();
+  Scene::markChanged();
   p->rect->setWidth(width);
 }
 
@@ -177,6 +181,7 @@ int Viewport::getHeight() const
 void Viewport::setHeight(int height)
 {
   guardDisposed();
+  Scene::markChanged();
   Rect& r = *p->rect;
   p->rect->setHeight(height);
 }
@@ -190,6 +195,7 @@ Color& Viewport::getColor() const
 void Viewport::setColor(Color& color)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->color = color;
 }
 
@@ -202,6 +208,7 @@ Tone& Viewport::getTone() const
 void Viewport::setTone(Tone& tone)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->tone = tone;
 }
 
@@ -215,6 +222,7 @@ void Viewport::setOX(int value)
 {
   guardDisposed();
   if (geometry.orig.x == value) return;
+  Scene::markChanged();
   geometry.orig.x = value;
   notifyGeometryChange();
 }
@@ -229,6 +237,7 @@ void Viewport::setOY(int value)
 {
   guardDisposed();
   if (geometry.orig.y == value) return;
+  Scene::markChanged();
   geometry.orig.y = value;
   notifyGeometryChange();
 }
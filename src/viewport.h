@@ -53,6 +53,7 @@ private:
   void geometryChanged();
   void composite();
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawViewport; }
   void onGeometryChange(const Geometry &);
   bool isEffectiveViewport(Rect *&, Color *&, Tone *&) const;
   void releaseResources();
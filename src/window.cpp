@@ -33,6 +33,9 @@
 #include "quadarray.h"
 #include "texpool.h"
 #include "glstate.h"
+#include "graphics.h"
+#include "pickindex.h"
+#include <SDL_rect.h>
 #include <sigc++/connection.h>
 
 #define MINOPENH 32
@@ -175,6 +178,8 @@ struct WindowPrivate
   bool pause;
   sigc::connection cursorRectCon;
   Vec2i sceneOffset;
+  // Screen space rectangle of the scene, windows get clipped to it
+  IntRect sceneRect;
   Vec2i position;
   Vec2i size;
   Vec2i contentsOffset;
@@ -210,6 +215,11 @@ struct WindowPrivate
       p->drawControls();
     }
 
+    FrameProfiler::Phase profilePhase() const
+    {
+      return FrameProfiler::DrawWindow;
+    }
+
     void release()
     {
       unlink();
@@ -230,8 +240,9 @@ struct WindowPrivate
   bool controlsVertDirty;
   EtcTemps tmp;
   sigc::connection prepareCon;
+  PickEntry pick;
 
-  WindowPrivate(Viewport *viewport = 0, int mode = 0)
+  WindowPrivate(Window *self, Viewport *viewport = 0, int mode = 0)
   : windowskin(0),
     contents(0),
     bgStretch(true),
@@ -255,7 +266,8 @@ struct WindowPrivate
     cursorAniAlphaIdx(0),
     pauseAniAlphaIdx(0),
     pauseAniQuadIdx(0),
-    controlsVertDirty(true)
+    controlsVertDirty(true),
+    pick(self)
   {
     refreshCursorRectCon();
     controlsQuadArray.resize(14);
@@ -273,6 +285,8 @@ struct WindowPrivate
     shState->texPool().release(baseTex);
     cursorRectCon.disconnect();
     prepareCon.disconnect();
+    if (pick.slot >= 0)
+      shState->graphics().pickIndex().remove(pick);
   }
 
   void processOpenMode()
@@ -474,8 +488,28 @@ struct WindowPrivate
     controlsQuadCount = i;
   }
 
+  void updatePick()
+  {
+    Window *self = static_cast<Window*>(pick.element);
+    Viewport *viewport = self->getViewport();
+    if (nullOrDisposed(viewport))
+      pick.root = self;
+    else
+      pick.root = viewport;
+    IntRect rect;
+    // Windows still opening or closing don't take clicks
+    if (openness == 100) {
+      IntRect box(position + sceneOffset, size);
+      if (!SDL_IntersectRect(&box, &sceneRect, &rect))
+        rect = IntRect();
+    }
+    shState->graphics().pickIndex().update(pick, rect);
+  }
+
   void prepare()
   {
+    if (pick.data)
+      updatePick();
     if (size.x <= 0 || size.y <= 0)
       return;
     bool updateBaseQuadArray = false;
@@ -618,8 +652,9 @@ struct WindowPrivate
 
 Window::Window(Viewport *viewport, int mode) : ViewportElement(viewport)
 {
-  p = new WindowPrivate(viewport, mode);
+  p = new WindowPrivate(this, viewport, mode);
   if (p->openMode < 2) p->sceneOffset = scene->getGeometry().offset();
+  p->sceneRect = scene->getGeometry().rect;
 }
 
 Window::~Window()
@@ -631,6 +666,9 @@ void Window::update()
 {
   if (isDisposed())
     return;
+  // The cursor and pause sign keep animating while shown
+  if (p->needOpenness || p->active || p->pause)
+    Scene::markChanged();
   p->updateOpenness();
   p->updateControls();
   p->stepAnimations();
@@ -669,12 +707,14 @@ bool Window::get_pause() const
 void Window::set_x(int value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->position.x = value;
 }
 
 void Window::set_y(int value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->position.y = value;
   p->needOpenness = p->openMode > 0;
   p->processOpenMode();
@@ -683,6 +723,7 @@ void Window::set_y(int value)
 void Window::set_xy(int val, int num)
 {
   guardDisposed();
+  Scene::markChanged();
   p->position.x = val;
   p->position.y = num;
   p->needOpenness = p->openMode > 0;
@@ -692,18 +733,21 @@ void Window::set_xy(int val, int num)
 void Window::set_pause_x(int x)
 {
   guardDisposed();
+  Scene::markChanged();
   p->pause_x = x;
 }
 
 void Window::set_pause_y(int y)
 {
   guardDisposed();
+  Scene::markChanged();
   p->pause_y = y;
 }
 
 void Window::set_pause_xy(int x, int y)
 {
   guardDisposed();
+  Scene::markChanged();
   p->pause_x = x;
   p->pause_y = y;
 }
@@ -713,6 +757,7 @@ void Window::setWidth(int value)
   guardDisposed();
   if (p->size.x == value)
     return;
+  Scene::markChanged();
   p->size.x = value;
   p->baseVertDirty = true;
 }
@@ -722,6 +767,7 @@ void Window::setHeight(int value)
   guardDisposed();
   if (p->size.y == value)
     return;
+  Scene::markChanged();
   p->size.y = value;
   p->baseVertDirty = true;
   p->needOpenness = p->openMode > 0;
@@ -733,6 +779,7 @@ void Window::setOX(int value)
   guardDisposed();
   if (p->contentsOffset.x == value)
     return;
+  Scene::markChanged();
   p->contentsOffset.x = value;
   p->controlsVertDirty = true;
 }
@@ -742,6 +789,7 @@ void Window::setOY(int value)
   guardDisposed();
   if (p->contentsOffset.y == value)
     return;
+  Scene::markChanged();
   p->contentsOffset.y = value;
   p->controlsVertDirty = true;
 }
@@ -755,12 +803,14 @@ Rect& Window::getCursorRect() const
 void Window::setCursorRect(Rect& rect)
 {
   guardDisposed();
+  Scene::markChanged();
   *p->cursorRect = rect;
 }
 
 void Window::setWindowskin(Bitmap *value)
 {
   guardDisposed();
+  Scene::markChanged();
   p->windowskin = value;
   if (nullOrDisposed(value))
     value->ensureNonMega();
@@ -771,6 +821,7 @@ void Window::setContents(Bitmap *value)
   guardDisposed();
   if (p->contents == value)
     return;
+  Scene::markChanged();
   p->contents = value;
   p->controlsVertDirty = p->openness == 100;
   if (nullOrDisposed(value))
@@ -784,6 +835,7 @@ void Window::setStretch(bool value)
   guardDisposed();
   if (value == p->bgStretch)
     return;
+  Scene::markChanged();
   p->bgStretch = value;
   p->baseVertDirty = true;
 }
@@ -793,6 +845,7 @@ void Window::setActive(bool value)
   guardDisposed();
   if (p->active == value)
     return;
+  Scene::markChanged();
   p->active = value;
   p->cursorAniAlphaIdx = 0;
 }
@@ -802,6 +855,7 @@ void Window::set_pause(bool value)
   guardDisposed();
   if (p->pause == value)
     return;
+  Scene::markChanged();
   p->pause = value;
   p->pauseAniAlphaIdx = 0;
   p->pauseAniQuadIdx = 0;
@@ -817,6 +871,7 @@ int Window::getOpenMode() const
 void Window::setOpenMode(int val)
 {
   guardDisposed();
+  Scene::markChanged();
   p->openMode = (val < 0 && val > 3)? 0 : val;
   p->openness = p->openMode == 0 ? 100 : 0;
   p->processOpenMode();
@@ -835,6 +890,7 @@ void Window::setOpenness(int val)
   guardDisposed();
   if (p->openness == val)
     return;
+  Scene::markChanged();
   p->openness = val < 0 ? 0 : val > 100 ? 100 : val;
   p->needOpenness = true;
   p->processOpenMode();
@@ -879,6 +935,7 @@ void Window::setOpacity(int value)
   guardDisposed();
   if (p->opacity == value)
     return;
+  Scene::markChanged();
   p->opacity = value;
   p->opacityDirty = true;
 }
@@ -888,6 +945,7 @@ void Window::setBackOpacity(int value)
   guardDisposed();
   if (p->backOpacity == value)
     return;
+  Scene::markChanged();
   p->backOpacity = value;
   p->opacityDirty = true;
 }
@@ -897,6 +955,7 @@ void Window::setContentsOpacity(int value)
   guardDisposed();
   if (p->contentsOpacity == value)
     return;
+  Scene::markChanged();
   p->contentsOpacity = value;
   p->contentsQuad.setColor(Vec4(1, 1, 1, p->contentsOpacity.norm));
 }
@@ -915,16 +974,31 @@ void Window::draw()
 void Window::onGeometryChange(const Scene::Geometry &geo)
 {
   p->sceneOffset = geo.offset();
+  p->sceneRect = geo.rect;
+}
+
+void *Window::getPickData() const
+{
+  return p->pick.data;
+}
+
+void Window::setPickData(void *data)
+{
+  p->pick.data = data;
+  if (!data)
+    shState->graphics().pickIndex().remove(p->pick);
 }
 
 void Window::setZ(int value)
 {
+  Scene::markChanged();
   ViewportElement::setZ(value);
   p->controlsElement.setZ(value + 2);
 }
 
 void Window::setVisible(bool value)
 {
+  Scene::markChanged();
   ViewportElement::setVisible(value);
   p->controlsElement.setVisible(value);
 }
@@ -67,6 +67,9 @@ public:
     bool isClosed() const;
     bool is_mouse_inside() const;
     bool is_mouse_inside(int, int, int, int) const;
+    // See Sprite::setPickData()
+    void *getPickData() const;
+    void setPickData(void *data);
     void updateOpenness();
     int  getOpenMode() const;
     void setOpenMode(int);
@@ -76,6 +79,7 @@ public:
 private:
   WindowPrivate *p;
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawWindow; }
   void onGeometryChange(const Scene::Geometry &);
   void setVisible(bool value);
   void onViewportChange();
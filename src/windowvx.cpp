@@ -693,6 +693,8 @@ void WindowVX::update()
 { //guardDisposed();
   if (isDisposed())
     return;
+  if (p->active || p->pause)
+    Scene::markChanged();
   p->stepAnimations();
   p->updatePauseQuad();
   p->updateCursorAlpha();
@@ -701,6 +703,7 @@ void WindowVX::update()
 void WindowVX::move(int x, int y, int width, int height)
 {
   guardDisposed();
+  Scene::markChanged();
   p->width = width;
   p->height = height;
   const Vec2i size(std::max(0, width), std::max(0, height));
@@ -771,6 +774,7 @@ void WindowVX::setWindowskin(Bitmap *value)
   guardDisposed();
   if (p->windowskin == value)
     return;
+  Scene::markChanged();
   p->windowskin = value;
   p->base.texDirty = true;
 }
@@ -780,6 +784,7 @@ void WindowVX::setContents(Bitmap *value)
   guardDisposed();
   if (p->contents == value)
     return;
+  Scene::markChanged();
   p->contents = value;
   if (nullOrDisposed(value))
     return;
@@ -793,6 +798,7 @@ void WindowVX::setActive(bool value)
   guardDisposed();
   if (p->active == value)
     return;
+  Scene::markChanged();
   p->active = value;
   p->cursorAlphaIdx = cursorAlphaResetIdx;
   p->updateCursorAlpha();
@@ -803,6 +809,7 @@ void WindowVX::setArrowsVisible(bool value)
   guardDisposed();
   if (p->arrowsVisible == value)
     return;
+  Scene::markChanged();
   p->arrowsVisible = value;
   p->ctrlVertDirty = true;
 }
@@ -812,6 +819,7 @@ void WindowVX::setPause(bool value)
   guardDisposed();
   if (p->pause == value)
     return;
+  Scene::markChanged();
   p->pause = value;
   p->pauseAlphaIdx = 0;
   p->pauseQuadIdx = 0;
@@ -823,6 +831,7 @@ void WindowVX::set_width(int value)
   guardDisposed();
   if (p->width == value)
     return;
+  Scene::markChanged();
   p->width = value;
   p->geo.w = std::max(0, value);
   p->base.vertDirty = true;
@@ -837,6 +846,7 @@ void WindowVX::set_height(int value)
   guardDisposed();
   if (p->height == value)
     return;
+  Scene::markChanged();
   p->height = value;
   p->geo.h = std::max(0, value);
   p->base.vertDirty = true;
@@ -849,18 +859,21 @@ void WindowVX::set_height(int value)
 void WindowVX::set_x(int x)
 {
   guardDisposed();
+  Scene::markChanged();
   p->geo.x = x;
 }
 
 void WindowVX::set_y(int y)
 {
   guardDisposed();
+  Scene::markChanged();
   p->geo.y = y;
 }
 
 void WindowVX::set_xy(int x, int y)
 {
   guardDisposed();
+  Scene::markChanged();
   p->geo.x = x;
   p->geo.y = y;
 }
@@ -868,18 +881,21 @@ void WindowVX::set_xy(int x, int y)
 void WindowVX::set_pause_x(int x)
 {
   guardDisposed();
+  Scene::markChanged();
   p->pause_x = x;
 }
 
 void WindowVX::set_pause_y(int y)
 {
   guardDisposed();
+  Scene::markChanged();
   p->pause_y = y;
 }
 
 void WindowVX::set_pause_xy(int x, int y)
 {
   guardDisposed();
+  Scene::markChanged();
   p->pause_x = x;
   p->pause_y = y;
 }
@@ -889,6 +905,7 @@ void WindowVX::setOX(int value)
   guardDisposed();
   if (p->contentsOff.x == value)
     return;
+  Scene::markChanged();
   p->contentsOff.x = value;
   p->ctrlVertDirty = true;
 }
@@ -898,6 +915,7 @@ void WindowVX::setOY(int value)
   guardDisposed();
   if (p->contentsOff.y == value)
     return;
+  Scene::markChanged();
   p->contentsOff.y = value;
   p->ctrlVertDirty = true;
 }
@@ -907,6 +925,7 @@ void WindowVX::setPadding(int value)
   guardDisposed();
   if (p->padding == value)
     return;
+  Scene::markChanged();
   p->padding = value;
   p->paddingBottom = value;
   p->clipRectDirty = true;
@@ -917,6 +936,7 @@ void WindowVX::setPaddingBottom(int value)
   guardDisposed();
   if (p->paddingBottom == value)
     return;
+  Scene::markChanged();
   p->paddingBottom = value;
   p->clipRectDirty = true;
 }
@@ -926,6 +946,7 @@ void WindowVX::setOpacity(int value)
   guardDisposed();
   if (p->opacity == value)
     return;
+  Scene::markChanged();
   p->opacity = value;
   p->base.quad.setColor(Vec4(1, 1, 1, p->opacity.norm));
 }
@@ -935,6 +956,7 @@ void WindowVX::setBackOpacity(int value)
   guardDisposed();
   if (p->backOpacity == value)
     return;
+  Scene::markChanged();
   p->backOpacity = value;
   p->base.texDirty = true;
 }
@@ -944,6 +966,7 @@ void WindowVX::setContentsOpacity(int value)
   guardDisposed();
   if (p->contentsOpacity == value)
     return;
+  Scene::markChanged();
   p->contentsOpacity = value;
   p->contentsQuad.setColor(Vec4(1, 1, 1, p->contentsOpacity.norm));
 }
@@ -953,6 +976,7 @@ void WindowVX::setOpenness(int value)
   guardDisposed();
   if (p->openness == value)
     return;
+  Scene::markChanged();
   p->openness = value;
   p->updateBaseQuad();
 }
@@ -81,6 +81,7 @@ private:
   WindowVXPrivate *p;
 
   void draw();
+  FrameProfiler::Phase profilePhase() const { return FrameProfiler::DrawWindow; }
   void onGeometryChange(const Scene::Geometry &);
 
   void releaseResources();